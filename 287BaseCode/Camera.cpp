@@ -9,6 +9,11 @@
  */
 
 RaytracingCamera::RaytracingCamera(const glm::vec3 &viewingPos, const glm::vec3 &lookAtPt, const glm::vec3 &up) {
+	static unsigned int nextId = 0;
+	id = nextId++;
+	version = 1;			// never 0, the version of caches and view states not built yet
+	nx = ny = 0.0f;
+	left = right = bottom = top = 0.0f;
 	changeConfiguration(viewingPos, lookAtPt, up);
 }
 
@@ -25,7 +30,83 @@ void RaytracingCamera::changeConfiguration(const glm::vec3 &viewingPos, const gl
 	glm::vec3 w = glm::normalize(-viewingDirection);
 	glm::vec3 u = glm::normalize(glm::cross(up, w));
 	glm::vec3 v = glm::normalize(glm::cross(w, u));
-	cameraFrame.setFrame(viewingPos, u, v, w);
+	if (viewingPos != cameraFrame.origin || u != cameraFrame.u ||
+		v != cameraFrame.v || w != cameraFrame.w) {
+		cameraFrame.setFrame(viewingPos, u, v, w);
+		version++;
+	}
+}
+
+/**
+ * @fn	Ray RaytracingCamera::getPixelRay(int x, int y) const
+ * @brief	Determines the ray through the center of pixel (x, y).
+ * @param	x	The x coordinate.
+ * @param	y	The y coordinate.
+ * @return	The ray through the center of pixel (x, y).
+ */
+
+Ray RaytracingCamera::getPixelRay(int x, int y) const {
+	return getRay((float)x, (float)y);
+}
+
+/**
+ * @fn	void RaytracingCamera::updateRayCache()
+ * @brief	Rebuilds any cached ray information, if the camera has changed since
+ * 			it was last built. The default camera caches nothing.
+ */
+
+void RaytracingCamera::updateRayCache() {
+}
+
+/**
+ * @fn	bool RaytracingCamera::projectToWindow(const glm::vec3 &pt, glm::vec2 &windowPt) const
+ * @brief	Projects a world point onto the window. The default camera cannot project.
+ * @param 		  	pt			The point, in world coordinates.
+ * @param [in,out]	windowPt	The (fractional) pixel coordinates of the point.
+ * @return	True iff the point could be projected.
+ */
+
+bool RaytracingCamera::projectToWindow(const glm::vec3 &pt, glm::vec2 &windowPt) const {
+	return false;
+}
+
+/**
+ * @fn	bool RaytracingCamera::projectRayToWindow(const Ray &ray, BoundingBoxf &windowBox) const
+ * @brief	Computes the window rectangle covered by the visible part of a ray.
+ * 			The default camera cannot project.
+ * @param 		  	ray		 	The ray, in world coordinates.
+ * @param [in,out]	windowBox	The (fractional) pixel rectangle covered by the ray.
+ * @return	True iff the ray could be projected.
+ */
+
+bool RaytracingCamera::projectRayToWindow(const Ray &ray, BoundingBoxf &windowBox) const {
+	return false;
+}
+
+/**
+ * @fn	bool RaytracingCamera::projectBoundsToWindow(const BoundingBox3D &box, BoundingBoxf &windowBox) const
+ * @brief	Computes the window rectangle covered by a 3D bounding box.
+ * @param 		  	box		 	The bounding box, in world coordinates.
+ * @param [in,out]	windowBox	The (fractional) pixel rectangle covered by the box.
+ * @return	True iff every corner of the box could be projected.
+ */
+
+bool RaytracingCamera::projectBoundsToWindow(const BoundingBox3D &box, BoundingBoxf &windowBox) const {
+	for (int i = 0; i < 8; i++) {
+		glm::vec2 windowPt;
+		if (!projectToWindow(box.getCorner(i), windowPt)) {
+			return false;
+		}
+		if (i == 0) {
+			windowBox = BoundingBoxf(windowPt.x, windowPt.x, windowPt.y, windowPt.y);
+		} else {
+			windowBox.lx = std::min(windowBox.lx, windowPt.x);
+			windowBox.rx = std::max(windowBox.rx, windowPt.x);
+			windowBox.ly = std::min(windowBox.ly, windowPt.y);
+			windowBox.ry = std::max(windowBox.ry, windowPt.y);
+		}
+	}
+	return true;
 }
 
 /**
@@ -40,6 +121,9 @@ void RaytracingCamera::changeConfiguration(const glm::vec3 &viewingPos, const gl
 PerspectiveCamera::PerspectiveCamera(const glm::vec3 &pos, const glm::vec3 &lookAtPt, const glm::vec3 &up, float FOVRads)
 	: RaytracingCamera(pos, lookAtPt, up) {
 	fov = FOVRads;
+	distToPlane = 0.0f;
+	cacheVersion = 0;
+	cacheWidth = cacheHeight = 0;
 }
 
 /**
@@ -79,13 +163,18 @@ glm::vec2 RaytracingCamera::getProjectionPlaneCoordinates(float x, float y) cons
 
 void PerspectiveCamera::calculateViewingParameters(int W, int H) {
 	// fill in nx, ny, distToPlane, top, bottom, left, and right
+	float newDist = 1.0f / std::tan(fov / 2.0f);
+	if (nx == (float)W && ny == (float)H && distToPlane == newDist) {
+		return;
+	}
 	nx = (float)W;
 	ny = (float)H;
-	distToPlane = 1.0f / std::tan(fov / 2.0f);
+	distToPlane = newDist;
 	top = 1.0f;
 	bottom = -top;
 	right = top * (nx / ny);
 	left = -right;
+	version++;
 }
 
 /**
@@ -121,12 +210,126 @@ Ray OrthographicCamera::getRay(float x, float y) const {
  */
 
 Ray PerspectiveCamera::getRay(float x, float y) const {
+	if (cacheVersion == version) {
+		return Ray(cameraFrame.origin, rayCorner + x * rayDeltaX + y * rayDeltaY);
+	}
 	glm::vec2 uv = getProjectionPlaneCoordinates(x, y);
 	glm::vec3 rayDirection = glm::normalize((float)(-distToPlane) * cameraFrame.w +
 												uv.x * cameraFrame.u + uv.y * cameraFrame.v);
 	return Ray(cameraFrame.origin, rayDirection);
 }
 
+/**
+ * @fn	Ray PerspectiveCamera::getPixelRay(int x, int y) const
+ * @brief	Determines the ray through the center of pixel (x, y). Uses the direction
+ * 			table when it is current, so no per-pixel projection or normalization is done.
+ * @param	x	The x coordinate.
+ * @param	y	The y coordinate.
+ * @return	The ray through the center of pixel (x, y).
+ */
+
+Ray PerspectiveCamera::getPixelRay(int x, int y) const {
+	if (cacheVersion == version && x >= 0 && x < cacheWidth && y >= 0 && y < cacheHeight) {
+		return Ray(cameraFrame.origin, rayDirections[y * cacheWidth + x], true);
+	}
+	return getRay((float)x, (float)y);
+}
+
+/**
+ * @fn	void PerspectiveCamera::updateRayCache()
+ * @brief	Rebuilds the per-pixel direction table and the row/column increments
+ * 			used by getRay. Does nothing if the camera has not changed.
+ */
+
+void PerspectiveCamera::updateRayCache() {
+	if (cacheVersion == version) {
+		return;
+	}
+	float du = (right - left) / nx;
+	float dv = (top - bottom) / ny;
+	rayDeltaX = du * cameraFrame.u;
+	rayDeltaY = dv * cameraFrame.v;
+	rayCorner = -distToPlane * cameraFrame.w +
+				(left + 0.5f * du) * cameraFrame.u +
+				(bottom + 0.5f * dv) * cameraFrame.v;
+
+	cacheWidth = (int)nx;
+	cacheHeight = (int)ny;
+	rayDirections.resize(cacheWidth * cacheHeight);
+	for (int y = 0; y < cacheHeight; ++y) {
+		glm::vec3 rowStart = rayCorner + (float)y * rayDeltaY;
+		for (int x = 0; x < cacheWidth; ++x) {
+			rayDirections[y * cacheWidth + x] = glm::normalize(rowStart + (float)x * rayDeltaX);
+		}
+	}
+	cacheVersion = version;
+}
+
+/**
+ * @fn	bool PerspectiveCamera::projectToWindow(const glm::vec3 &pt, glm::vec2 &windowPt) const
+ * @brief	Projects a world point onto the window. This is the inverse of getRay.
+ * @param 		  	pt			The point, in world coordinates.
+ * @param [in,out]	windowPt	The (fractional) pixel coordinates of the point.
+ * @return	True iff the point is in front of the camera.
+ */
+
+bool PerspectiveCamera::projectToWindow(const glm::vec3 &pt, glm::vec2 &windowPt) const {
+	glm::vec3 q = pt - cameraFrame.origin;
+	float depth = -glm::dot(q, cameraFrame.w);
+	if (depth <= EPSILON) {
+		return false;
+	}
+	float u = distToPlane * glm::dot(q, cameraFrame.u) / depth;
+	float v = distToPlane * glm::dot(q, cameraFrame.v) / depth;
+	windowPt.x = (u - left) / (right - left) * nx - 0.5f;
+	windowPt.y = (v - bottom) / (top - bottom) * ny - 0.5f;
+	return true;
+}
+
+/**
+ * @fn	bool PerspectiveCamera::projectRayToWindow(const Ray &ray, BoundingBoxf &windowBox) const
+ * @brief	Computes the window rectangle covered by the visible part of a ray. A ray
+ * 			heading away from the camera ends at its vanishing point; otherwise, its
+ * 			image is a half-line and the rectangle is unbounded in that direction.
+ * @param 		  	ray		 	The ray, in world coordinates.
+ * @param [in,out]	windowBox	The (fractional) pixel rectangle covered by the ray.
+ * @return	True iff the ray's origin is in front of the camera.
+ */
+
+bool PerspectiveCamera::projectRayToWindow(const Ray &ray, BoundingBoxf &windowBox) const {
+	glm::vec2 start;
+	if (!projectToWindow(ray.origin, start)) {
+		return false;
+	}
+	windowBox = BoundingBoxf(start.x, start.x, start.y, start.y);
+	glm::vec3 q = ray.origin - cameraFrame.origin;
+	float x0 = glm::dot(q, cameraFrame.u);
+	float y0 = glm::dot(q, cameraFrame.v);
+	float z0 = -glm::dot(q, cameraFrame.w);
+	float dx = glm::dot(ray.direction, cameraFrame.u);
+	float dy = glm::dot(ray.direction, cameraFrame.v);
+	float dz = -glm::dot(ray.direction, cameraFrame.w);
+	if (dz > EPSILON) {
+		float u = distToPlane * dx / dz;
+		float v = distToPlane * dy / dz;
+		float vanishX = (u - left) / (right - left) * nx - 0.5f;
+		float vanishY = (v - bottom) / (top - bottom) * ny - 0.5f;
+		windowBox.lx = std::min(windowBox.lx, vanishX);
+		windowBox.rx = std::max(windowBox.rx, vanishX);
+		windowBox.ly = std::min(windowBox.ly, vanishY);
+		windowBox.ry = std::max(windowBox.ry, vanishY);
+	} else {
+		// the image runs off to infinity in the direction of d(window)/dt
+		float gx = dx * z0 - x0 * dz;
+		float gy = dy * z0 - y0 * dz;
+		if (gx > 0) windowBox.rx = FLT_MAX;
+		if (gx < 0) windowBox.lx = -FLT_MAX;
+		if (gy > 0) windowBox.ry = FLT_MAX;
+		if (gy < 0) windowBox.ly = -FLT_MAX;
+	}
+	return true;
+}
+
 /**
  * @fn	void PerspectiveCamera::setFOV(float FOV, int W, int H)
  * @brief	Sets a camera's field of view.
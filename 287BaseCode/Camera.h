@@ -12,11 +12,20 @@ struct RaytracingCamera {
 	float fov;							//!< The camera's field of view
 	float left, right, bottom, top;		//!< The camera's field of view
 	float nx, ny;						//!< Window size
+	unsigned int version;				//!< Starts at 1 and is incremented whenever the camera's configuration changes
+	unsigned int id;					//!< Identifies the camera; copies share the id of the original
 	RaytracingCamera(const glm::vec3 &pos, const glm::vec3 &lookAtPt, const glm::vec3 &up);
+	virtual ~RaytracingCamera() {}
 	void changeConfiguration(const glm::vec3 &pos, const glm::vec3 &lookAtPt, const glm::vec3 &up);
 	glm::vec2 getProjectionPlaneCoordinates(float x, float y) const;
 	virtual void calculateViewingParameters(int width, int height) = 0;
 	virtual Ray getRay(float x, float y) const = 0;
+	virtual Ray getPixelRay(int x, int y) const;
+	virtual void updateRayCache();
+	virtual bool projectToWindow(const glm::vec3 &pt, glm::vec2 &windowPt) const;
+	virtual bool projectRayToWindow(const Ray &ray, BoundingBoxf &windowBox) const;
+	bool projectBoundsToWindow(const BoundingBox3D &box, BoundingBoxf &windowBox) const;
+	virtual RaytracingCamera *clone() const = 0;
 	friend std::ostream &operator << (std::ostream &os, const RaytracingCamera &camera);
 };
 
@@ -30,7 +39,19 @@ struct PerspectiveCamera : public RaytracingCamera {
 	PerspectiveCamera(const glm::vec3 &pos, const glm::vec3 &lookAtPt, const glm::vec3 &up, float FOVRads);
 	virtual void calculateViewingParameters(int width, int height);
 	virtual Ray getRay(float x, float y) const;
+	virtual Ray getPixelRay(int x, int y) const;
+	virtual void updateRayCache();
+	virtual bool projectToWindow(const glm::vec3 &pt, glm::vec2 &windowPt) const;
+	virtual bool projectRayToWindow(const Ray &ray, BoundingBoxf &windowBox) const;
+	virtual RaytracingCamera *clone() const { return new PerspectiveCamera(*this); }
 	void setFOV(float FOV, int W, int H);
+protected:
+	unsigned int cacheVersion;				//!< Camera version the cached values were built for; 0 before they are first built
+	glm::vec3 rayCorner;					//!< Unnormalized direction through the center of pixel (0, 0)
+	glm::vec3 rayDeltaX;					//!< Change in direction when moving one pixel right
+	glm::vec3 rayDeltaY;					//!< Change in direction when moving one pixel up
+	int cacheWidth, cacheHeight;			//!< Dimensions of the direction table
+	std::vector<glm::vec3> rayDirections;	//!< Normalized direction through each pixel center
 };
 
 /**
@@ -43,4 +64,5 @@ struct OrthographicCamera : public RaytracingCamera {
 	OrthographicCamera(const glm::vec3 &pos, const glm::vec3 &lookAtPt, const glm::vec3 &up, float ppwu);
 	virtual void calculateViewingParameters(int width, int height);
 	virtual Ray getRay(float x, float y) const;
+	virtual RaytracingCamera *clone() const { return new OrthographicCamera(*this); }
 };
\ No newline at end of file
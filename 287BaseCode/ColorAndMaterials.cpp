@@ -1,3 +1,6 @@
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 #include "ColorAndMaterials.h"
 
 /**
@@ -141,6 +144,19 @@ Material Material::operator -(const Material &mat) const {
 	return result;
 }
 
+/**
+ * @fn	bool Material::operator==(const Material &mat) const
+ * @brief	Compares two Materials
+ * @param	mat	The second Material.
+ * @return	True iff all properties of the two Materials are equal.
+ */
+
+bool Material::operator ==(const Material &mat) const {
+	return ambient == mat.ambient && diffuse == mat.diffuse &&
+			specular == mat.specular && shininess == mat.shininess &&
+			alpha == mat.alpha;
+}
+
 /**
  * @fn	Material Material::makeTransparent(float alpha, const color &C)
  * @brief	Makes a transparent version of a given color.
@@ -167,3 +183,107 @@ Material operator *(float w, const Material &mat) {
 	return mat * w;
 }
 
+
+/**
+ * @struct	MaterialHash
+ * @brief	Hashes a Material from its properties, for looking it up in the table.
+ */
+
+struct MaterialHash {
+	size_t operator ()(const Material &mat) const {
+		const float props[] = { mat.ambient.r, mat.ambient.g, mat.ambient.b,
+								mat.diffuse.r, mat.diffuse.g, mat.diffuse.b,
+								mat.specular.r, mat.specular.g, mat.specular.b,
+								mat.shininess, mat.alpha };
+		size_t h = 0;
+		for (float p : props) {
+			h = h * 31 + std::hash<float>()(p);
+		}
+		return h;
+	}
+};
+
+/**
+ * @struct	MaterialStore
+ * @brief	The contents of the MaterialTable.
+ */
+
+struct MaterialStore {
+	std::deque<Material> materials;							//!< the materials, by index
+	std::unordered_map<Material, int, MaterialHash> indices;	//!< index of each material
+	std::deque<Material> frameMaterials;					//!< the materials made during the frame
+	std::mutex lock;										//!< guards additions
+};
+
+/**
+ * @fn	static MaterialStore &materialStore()
+ * @brief	Gets the MaterialTable's contents. They are created on first use, since
+ * 			shapes built during static initialization already add materials.
+ * @return	The contents.
+ */
+
+static MaterialStore &materialStore() {
+	static MaterialStore store;
+	return store;
+}
+
+/**
+ * @fn	int MaterialTable::indexOf(const Material &mat)
+ * @brief	Gets the index of a material, adding it to the table if it is new.
+ * @param	mat	The material.
+ * @return	The material's index.
+ */
+
+int MaterialTable::indexOf(const Material &mat) {
+	MaterialStore &store = materialStore();
+	std::lock_guard<std::mutex> guard(store.lock);
+	auto it = store.indices.find(mat);
+	if (it != store.indices.end()) {
+		return it->second;
+	}
+	int index = (int)store.materials.size();
+	store.materials.push_back(mat);
+	store.indices[mat] = index;
+	return index;
+}
+
+/**
+ * @fn	int MaterialTable::addFrameMaterial(const Material &mat)
+ * @brief	Adds a material that is only needed until the end of the frame. Unlike
+ * 			indexOf, equal materials are not looked up, since these are rarely reused.
+ * @param	mat	The material.
+ * @return	The material's index, valid until clearFrameMaterials is called.
+ */
+
+int MaterialTable::addFrameMaterial(const Material &mat) {
+	MaterialStore &store = materialStore();
+	std::lock_guard<std::mutex> guard(store.lock);
+	store.frameMaterials.push_back(mat);
+	return FIRST_FRAME_MATERIAL + (int)store.frameMaterials.size() - 1;
+}
+
+/**
+ * @fn	void MaterialTable::clearFrameMaterials()
+ * @brief	Removes the materials added by addFrameMaterial. Called at the start of
+ * 			each frame, when nothing refers to them any more.
+ */
+
+void MaterialTable::clearFrameMaterials() {
+	MaterialStore &store = materialStore();
+	std::lock_guard<std::mutex> guard(store.lock);
+	store.frameMaterials.clear();
+}
+
+/**
+ * @fn	const Material &MaterialTable::get(int index)
+ * @brief	Gets the material at an index.
+ * @param	index	An index returned by indexOf or addFrameMaterial.
+ * @return	The material.
+ */
+
+const Material &MaterialTable::get(int index) {
+	if (isFrameMaterial(index)) {
+		return materialStore().frameMaterials[index - FIRST_FRAME_MATERIAL];
+	}
+	return materialStore().materials[index];
+}
@@ -44,9 +44,29 @@ struct Material {
 	Material &operator +=(const Material &mat);
 	Material operator +(const Material &mat) const;
 	Material operator -(const Material &mat) const;
+	bool operator ==(const Material &mat) const;
 	static Material makeTransparent(float alpha, const color &C);
 };
 
+/**
+ * @struct	MaterialTable
+ * @brief	The materials that vertices and fragments refer to by index, so that they
+ * 			carry an int rather than a whole Material. Equal materials share an entry.
+ * 			Entries are added during vertex processing and never removed, so references
+ * 			to them stay valid; they may be read from any thread while none are added.
+ * 			Materials made during a frame, such as those interpolated by clipping,
+ * 			go into a separate part of the table that is emptied by clearFrameMaterials.
+ */
+
+struct MaterialTable {
+	static const int FIRST_FRAME_MATERIAL = 1 << 30;	//!< index of the first frame material
+	static int indexOf(const Material &mat);
+	static int addFrameMaterial(const Material &mat);
+	static bool isFrameMaterial(int index) { return index >= FIRST_FRAME_MATERIAL; }
+	static void clearFrameMaterials();
+	static const Material &get(int index);
+};
+
 // http://www.it.hiof.no/~borres/j3d/explain/light/p-materials.html
 const Material brass(std::vector<float>{0.329412f, 0.223529f, 0.027451f,
 	0.780392f, 0.568627f, 0.113725f,
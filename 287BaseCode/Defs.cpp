@@ -55,6 +55,17 @@ BoundingBox3D::BoundingBox3D(float left, float right, float bottom, float top, f
 		rz = back;
 }
 
+/**
+ * @fn	BoundingBox3D::BoundingBox3D(const glm::vec3 &minCorner, const glm::vec3 &maxCorner)
+ * @brief	Constructs a bounding box from its two extreme corners.
+ * @param	minCorner	The corner with the smallest x, y and z values.
+ * @param	maxCorner	The corner with the largest x, y and z values.
+ */
+
+BoundingBox3D::BoundingBox3D(const glm::vec3 &minCorner, const glm::vec3 &maxCorner)
+	: BoundingBox3D(minCorner.x, maxCorner.x, minCorner.y, maxCorner.y, minCorner.z, maxCorner.z) {
+}
+
 /**
  * @fn	float BoundingBox3D::width() const
  * @brief	Gets the width - x axis
@@ -85,6 +96,63 @@ float BoundingBox3D::depth() const {
 	return lz - rz;
 }
 
+/**
+ * @fn	glm::vec3 BoundingBox3D::minCorner() const
+ * @brief	Gets the corner with the smallest x, y and z values.
+ * @return	The minimum corner.
+ */
+
+glm::vec3 BoundingBox3D::minCorner() const {
+	return glm::vec3(lx, ly, rz);
+}
+
+/**
+ * @fn	glm::vec3 BoundingBox3D::maxCorner() const
+ * @brief	Gets the corner with the largest x, y and z values.
+ * @return	The maximum corner.
+ */
+
+glm::vec3 BoundingBox3D::maxCorner() const {
+	return glm::vec3(rx, ry, lz);
+}
+
+/**
+ * @fn	glm::vec3 BoundingBox3D::getCorner(int i) const
+ * @brief	Gets one of the eight corners of the box.
+ * @param	i	Corner number, 0 through 7. Bits 0, 1 and 2 select the maximum x, y and z.
+ * @return	The corner.
+ */
+
+glm::vec3 BoundingBox3D::getCorner(int i) const {
+	return glm::vec3((i & 1) ? rx : lx, (i & 2) ? ry : ly, (i & 4) ? lz : rz);
+}
+
+/**
+ * @fn	bool BoundingBox3D::contains(const glm::vec3 &pt) const
+ * @brief	Determines if a point lies in the box.
+ * @param	pt	The point.
+ * @return	True iff the point is inside the box or on its boundary.
+ */
+
+bool BoundingBox3D::contains(const glm::vec3 &pt) const {
+	return lx <= pt.x && pt.x <= rx &&
+			ly <= pt.y && pt.y <= ry &&
+			rz <= pt.z && pt.z <= lz;
+}
+
+/**
+ * @fn	bool BoundingBox3D::operator == (const BoundingBox3D &other) const
+ * @brief	Equality operator.
+ * @param	other	The other box.
+ * @return	True iff the two boxes are identical.
+ */
+
+bool BoundingBox3D::operator == (const BoundingBox3D &other) const {
+	return lx == other.lx && rx == other.rx &&
+			ly == other.ly && ry == other.ry &&
+			lz == other.lz && rz == other.rz;
+}
+
 /**
  * @fn	void Frame::setInverse()
  * @brief	Sets the inverse based on the current parameters.
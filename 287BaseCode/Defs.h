@@ -23,6 +23,7 @@ const int WINDOW_WIDTH = 500;		//!< default window width.
 const int WINDOW_HEIGHT = 250;		//!< default window height.
 const unsigned char ESCAPE = 27;	//!< escape key.
 const int SLICES = 8;				//!< default value used when slicing up a curved object.
+const int TILE_SIZE = 16;			//!< width and height of a screen tile, in pixels.
 
 const float M_PI = std::acos(-1.0f);	//!< pi
 const float M_2PI = 2 * M_PI;			//!< 2pi	(360 degrees)
@@ -98,9 +99,15 @@ struct BoundingBox3D {
 	float ry;	//!< upper right y
 	float rz;	//!< upper right z
 	BoundingBox3D(float left, float right, float bottom, float top, float back, float front);
+	BoundingBox3D(const glm::vec3 &minCorner, const glm::vec3 &maxCorner);
 	float width() const;
 	float height() const;
 	float depth() const;
+	glm::vec3 minCorner() const;
+	glm::vec3 maxCorner() const;
+	glm::vec3 getCorner(int i) const;
+	bool contains(const glm::vec3 &pt) const;
+	bool operator == (const BoundingBox3D &other) const;
 };
 
 /**
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cstring>
+#include "EdgeAntialiaser.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define EDGE_AA_SSE2
+#include <emmintrin.h>
+#endif
+
+// a pixel is on an edge when the luma range around it is at least the larger of
+// EDGE_MIN_CONTRAST and 1/8 of the brightest luma around it.
+static const int EDGE_MIN_CONTRAST = 8;
+static const int EDGE_RELATIVE_SHIFT = 3;
+
+// how much an edge pixel is blended with its neighbor across the edge, at least.
+static const float EDGE_BLEND = 0.25f;
+
+// largest blend for pixels that differ from all of their neighbors (e.g., thin lines).
+static const float SUBPIXEL_BLEND = 0.75f;
+
+#ifdef EDGE_AA_SSE2
+/**
+ * @fn	static int depthEdgeMask(const float *depth, int index, int width, float depthThreshold)
+ * @brief	Tests sixteen consecutive pixels for depth discontinuities, four at a
+ * 			time. Matches EdgeAntialiaser::isDepthEdge for each pixel.
+ * @param	depth		  	The depth buffer.
+ * @param	index		  	Index of the first pixel.
+ * @param	width		  	Width of the frame buffer.
+ * @param	depthThreshold	Relative depth difference that marks an edge.
+ * @return	A mask with bit i set iff pixel index + i is on a depth edge.
+ */
+
+static int depthEdgeMask(const float *depth, int index, int width, float depthThreshold) {
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 epsilon = _mm_set1_ps(EPSILON);
+	const __m128 threshold = _mm_set1_ps(depthThreshold);
+	int mask = 0;
+	for (int i = 0; i < 16; i += 4) {
+		const float *p = depth + index + i;
+		__m128 d = _mm_loadu_ps(p);
+		__m128 absD = _mm_and_ps(d, absMask);
+		__m128 edge = _mm_setzero_ps();
+		const float *neighbors[2] = { p + 1, p + width };
+		for (int j = 0; j < 2; j++) {
+			__m128 n = _mm_loadu_ps(neighbors[j]);
+			__m128 scale = _mm_max_ps(_mm_max_ps(absD, _mm_and_ps(n, absMask)), epsilon);
+			__m128 difference = _mm_and_ps(_mm_sub_ps(d, n), absMask);
+			edge = _mm_or_ps(edge, _mm_cmpgt_ps(difference, _mm_mul_ps(threshold, scale)));
+		}
+		mask |= _mm_movemask_ps(edge) << i;
+	}
+	return mask;
+}
+#endif
+
+/**
+ * @fn	EdgeAntialiaser::EdgeAntialiaser()
+ * @brief	Constructs an antialiaser that uses luma only.
+ */
+
+EdgeAntialiaser::EdgeAntialiaser() : useDepth(false), depthThreshold(0.05f) {
+}
+
+/**
+ * @fn	void EdgeAntialiaser::apply(FrameBuffer &frameBuffer)
+ * @brief	Smooths the edges in a frame buffer's colors, in place.
+ * @param [in,out]	frameBuffer	The frame buffer.
+ */
+
+void EdgeAntialiaser::apply(FrameBuffer &frameBuffer) {
+	int width = frameBuffer.getWindowWidth();
+	int height = frameBuffer.getWindowHeight();
+	if (width < 3 || height < 3) {
+		return;
+	}
+	GLubyte *colors = frameBuffer.getColorBuffer();
+	const float *depth = useDepth ? frameBuffer.getDepthBuffer() : nullptr;
+	int rowBytes = BYTES_PER_PIXEL * width;
+
+	luma.resize(width * height);
+	for (int i = 0; i < width * height; i++) {
+		luma[i] = colors[BYTES_PER_PIXEL * i + 1];
+	}
+
+	// blending reads the unblended colors of the rows above and at each pixel
+	originalRows.resize(2 * rowBytes);
+	GLubyte *previousRow = &originalRows[0];
+	GLubyte *currentRow = &originalRows[rowBytes];
+	std::memcpy(previousRow, colors, rowBytes);
+	std::vector<int> edgePixels;
+	for (int y = 1; y < height - 1; y++) {
+		std::memcpy(currentRow, colors + y * rowBytes, rowBytes);
+		findEdges(y, width, depth, edgePixels);
+		for (unsigned int i = 0; i < edgePixels.size(); i++) {
+			blendPixel(colors, previousRow, currentRow, edgePixels[i], y, width);
+		}
+		std::swap(previousRow, currentRow);
+	}
+}
+
+/**
+ * @fn	void EdgeAntialiaser::findEdges(int y, int width, const float *depth, std::vector<int> &edgePixels) const
+ * @brief	Lists the pixels of a row that lie on an edge. Sixteen pixels are tested
+ * 			at a time with SSE2 where it is available, in luma and then in depth
+ * 			unless all sixteen are already luma edges.
+ * @param 		  	y		  	The row, which must not be the first or last.
+ * @param 		  	width	  	Width of the frame buffer.
+ * @param 		  	depth	  	The depth buffer, or nullptr to ignore depths.
+ * @param [out]		edgePixels	Receives the x coordinates of the edge pixels.
+ */
+
+void EdgeAntialiaser::findEdges(int y, int width, const float *depth,
+								std::vector<int> &edgePixels) const {
+	edgePixels.clear();
+	const unsigned char *row = &luma[y * width];
+	int x = 1;
+#ifdef EDGE_AA_SSE2
+	const __m128i minContrast = _mm_set1_epi8((char)EDGE_MIN_CONTRAST);
+	const __m128i lowBits = _mm_set1_epi8((char)(0xFF >> EDGE_RELATIVE_SHIFT));
+	const __m128i zero = _mm_setzero_si128();
+	for (; x + 16 <= width - 1; x += 16) {
+		__m128i M = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i N = _mm_loadu_si128((const __m128i *)(row + width + x));
+		__m128i S = _mm_loadu_si128((const __m128i *)(row - width + x));
+		__m128i E = _mm_loadu_si128((const __m128i *)(row + x + 1));
+		__m128i W = _mm_loadu_si128((const __m128i *)(row + x - 1));
+		__m128i hi = _mm_max_epu8(_mm_max_epu8(_mm_max_epu8(M, N), _mm_max_epu8(S, E)), W);
+		__m128i lo = _mm_min_epu8(_mm_min_epu8(_mm_min_epu8(M, N), _mm_min_epu8(S, E)), W);
+		__m128i range = _mm_subs_epu8(hi, lo);
+		__m128i threshold = _mm_max_epu8(_mm_and_si128(_mm_srli_epi16(hi, EDGE_RELATIVE_SHIFT), lowBits),
+											minContrast);
+		// range >= threshold exactly when threshold - range saturates to zero
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(threshold, range), zero));
+		if (depth != nullptr && mask != 0xFFFF) {
+			mask |= depthEdgeMask(depth, y * width + x, width, depthThreshold);
+		}
+		for (int i = 0; mask != 0; i++, mask >>= 1) {
+			if ((mask & 1) != 0) {
+				edgePixels.push_back(x + i);
+			}
+		}
+	}
+#endif
+	for (; x < width - 1; x++) {
+		int M = row[x], N = row[x + width], S = row[x - width], E = row[x + 1], W = row[x - 1];
+		int hi = std::max(std::max(std::max(M, N), std::max(S, E)), W);
+		int lo = std::min(std::min(std::min(M, N), std::min(S, E)), W);
+		int threshold = std::max(hi >> EDGE_RELATIVE_SHIFT, EDGE_MIN_CONTRAST);
+		if (hi - lo >= threshold || (depth != nullptr && isDepthEdge(depth, y * width + x, width))) {
+			edgePixels.push_back(x);
+		}
+	}
+}
+
+/**
+ * @fn	bool EdgeAntialiaser::isDepthEdge(const float *depth, int index, int width) const
+ * @brief	Determines if a pixel's depth differs sharply from the pixel to its
+ * 			right or above it.
+ * @param	depth	The depth buffer.
+ * @param	index	Index of the pixel.
+ * @param	width	Width of the frame buffer.
+ * @return	True iff there is a depth discontinuity at the pixel.
+ */
+
+bool EdgeAntialiaser::isDepthEdge(const float *depth, int index, int width) const {
+	float d = depth[index];
+	float neighbors[2] = { depth[index + 1], depth[index + width] };
+	for (int i = 0; i < 2; i++) {
+		float scale = std::max(std::max(std::abs(d), std::abs(neighbors[i])), EPSILON);
+		if (std::abs(d - neighbors[i]) > depthThreshold * scale) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @fn	void EdgeAntialiaser::blendPixel(GLubyte *colors, const GLubyte *previousRow, const GLubyte *currentRow, int x, int y, int width) const
+ * @brief	Blends an edge pixel with its neighbor across the edge. The direction of
+ * 			the edge comes from the luma gradients in the 3x3 neighborhood, and the
+ * 			amount of blending from how much the pixel differs from its neighbors.
+ * @param [in,out]	colors	   	The color buffer.
+ * @param 		  	previousRow	Unblended colors of row y - 1.
+ * @param 		  	currentRow 	Unblended colors of row y.
+ * @param 		  	x		   	The x coordinate of the pixel.
+ * @param 		  	y		   	The y coordinate of the pixel.
+ * @param 		  	width	   	Width of the frame buffer.
+ */
+
+void EdgeAntialiaser::blendPixel(GLubyte *colors, const GLubyte *previousRow, const GLubyte *currentRow,
+									int x, int y, int width) const {
+	const unsigned char *row = &luma[y * width];
+	int M = row[x], N = row[x + width], S = row[x - width], E = row[x + 1], W = row[x - 1];
+	int NE = row[x + width + 1], NW = row[x + width - 1];
+	int SE = row[x - width + 1], SW = row[x - width - 1];
+	int hi = std::max(std::max(std::max(M, N), std::max(S, E)), W);
+	int lo = std::min(std::min(std::min(M, N), std::min(S, E)), W);
+	int range = hi - lo;
+	if (range == 0) {
+		return;
+	}
+
+	float average = (2 * (N + S + E + W) + NE + NW + SE + SW) / 12.0f;
+	float subpixel = glm::clamp(std::abs(average - M) / range, 0.0f, 1.0f);
+	subpixel = (3.0f - 2.0f * subpixel) * subpixel * subpixel;
+	float blend = std::max(subpixel * subpixel * SUBPIXEL_BLEND, EDGE_BLEND);
+
+	int edgeHorz = std::abs(NW + SW - 2 * W) + 2 * std::abs(N + S - 2 * M) + std::abs(NE + SE - 2 * E);
+	int edgeVert = std::abs(NW + NE - 2 * N) + 2 * std::abs(W + E - 2 * M) + std::abs(SW + SE - 2 * S);
+	const GLubyte *other;
+	if (edgeHorz >= edgeVert) {
+		// the edge runs horizontally; blend with the pixel above or below
+		other = (std::abs(N - M) >= std::abs(S - M)) ? colors + BYTES_PER_PIXEL * ((y + 1) * width + x)
+													: previousRow + BYTES_PER_PIXEL * x;
+	} else {
+		other = (std::abs(E - M) >= std::abs(W - M)) ? currentRow + BYTES_PER_PIXEL * (x + 1)
+													: currentRow + BYTES_PER_PIXEL * (x - 1);
+	}
+	const GLubyte *self = currentRow + BYTES_PER_PIXEL * x;
+	GLubyte *out = colors + BYTES_PER_PIXEL * (y * width + x);
+	for (int c = 0; c < BYTES_PER_PIXEL; c++) {
+		out[c] = (GLubyte)(self[c] + blend * (other[c] - self[c]) + 0.5f);
+	}
+}
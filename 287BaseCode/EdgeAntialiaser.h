@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "FrameBuffer.h"
+
+/**
+ * @struct	EdgeAntialiaser
+ * @brief	A post-process that smooths jagged edges in a frame buffer's colors,
+ * 			in the style of FXAA. Edges are found from the contrast in luma (the
+ * 			green channel) and, optionally, from discontinuities in the depth
+ * 			buffer. Each edge pixel is blended with the neighbor across the edge.
+ * 			Works on any frame buffer, whether it was ray traced or rasterized.
+ */
+
+struct EdgeAntialiaser {
+	bool useDepth;			//!< true if depth discontinuities also mark edges
+	float depthThreshold;	//!< relative depth difference that marks an edge
+	EdgeAntialiaser();
+	void apply(FrameBuffer &frameBuffer);
+protected:
+	std::vector<unsigned char> luma;	//!< luma of each pixel
+	std::vector<GLubyte> originalRows;	//!< unblended colors of the previous and current rows
+	void findEdges(int y, int width, const float *depth, std::vector<int> &edgePixels) const;
+	bool isDepthEdge(const float *depth, int index, int width) const;
+	void blendPixel(GLubyte *colors, const GLubyte *previousRow, const GLubyte *currentRow,
+					int x, int y, int width) const;
+};
@@ -36,6 +36,7 @@ void renderObjects() {
 static void render() {
 	int frameStartTime = glutGet(GLUT_ELAPSED_TIME);
 
+	VertexOps::beginFrame();
 	frameBuffer.clearColorAndDepthBuffers();
 	int width = frameBuffer.getWindowWidth();
 	int height = frameBuffer.getWindowHeight();
@@ -0,0 +1,68 @@
+#include <random>
+#include "Rasterization.h"
+#include "Light.h"
+#include "WorkerPool.h"
+/*
+* Checks the fill rule of the triangle rasterizer. Draws 40 triangle fans, side by
+* side, with the scalar, vectorized and tiled coverage paths. The triangles of a fan
+* share edges, so no pixel should be covered twice, and every path should cover the
+* same pixels. Prints the counts of each path, and returns 1 if the check fails.
+*/
+
+/*
+* Builds the fans: 5 to 24 triangles each, around centers on an 8x5 grid, with
+* random radii and starting angles, in window coordinates of a 500x250 window.
+*/
+
+std::vector<VertexData> buildFans() {
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> U(0, 1);
+	std::vector<VertexData> verts;
+	for (int f = 0; f < 40; f++) {
+		glm::vec2 c(30 + (f % 8) * 60 + U(rng) * 4, 30 + (f / 8) * 45 + U(rng) * 4);
+		int n = 5 + f % 20;
+		float r = 5 + U(rng) * 17;
+		float phase = U(rng);
+		for (int i = 0; i < n; i++) {
+			float a0 = (i + phase) * M_2PI / n;
+			float a1 = (i + 1 + phase) * M_2PI / n;
+			glm::vec2 p0 = c + r * glm::vec2(cos(a0), sin(a0));
+			glm::vec2 p1 = c + r * glm::vec2(cos(a1), sin(a1));
+			verts.push_back(VertexData(glm::vec4(c, 0, 1), glm::vec3(0, 0, 1), silver, glm::vec3(c, 0)));
+			verts.push_back(VertexData(glm::vec4(p0, 0, 1), glm::vec3(0, 0, 1), silver, glm::vec3(p0, 0)));
+			verts.push_back(VertexData(glm::vec4(p1, 0, 1), glm::vec3(0, 0, 1), silver, glm::vec3(p1, 0)));
+		}
+	}
+	return verts;
+}
+
+int main(int argc, char *argv[]) {
+	FrameBuffer frameBuffer(500, 250);
+	std::vector<LightSourcePtr> lights = { new PositionalLight(glm::vec3(2, 1, 3), pureWhiteLight) };
+	std::vector<VertexData> verts = buildFans();
+	glm::mat4 viewingMatrix = glm::lookAt(glm::vec3(0, 1, 4), ORIGIN3D, Y_AXIS);
+	WorkerPool pool(3);
+
+	const char *names[] = { "scalar", "vectorized", "tiled" };
+	long long firstCovered = -1;
+	bool passed = true;
+	for (int path = 0; path < 3; path++) {
+		vectorizedCoverage = path != 0;
+		frameBuffer.clearColorAndDepthBuffers();
+		overdrawCounter.reset();
+		overdrawCounter.enabled = true;
+		drawManyFilledTriangles(frameBuffer, glm::vec3(0, 1, 4), lights, verts, viewingMatrix,
+								nullptr, path == 2 ? &pool : nullptr);
+		std::cout << names[path] << " (" << coveragePathName() << "): " << verts.size() / 3 << " triangles, "
+					<< overdrawCounter.pixelsCovered << " pixels covered, "
+					<< overdrawCounter.extraCoverage << " covered twice" << std::endl;
+		if (firstCovered < 0) {
+			firstCovered = overdrawCounter.pixelsCovered;
+		}
+		passed = passed && overdrawCounter.extraCoverage == 0 && overdrawCounter.pixelsCovered == firstCovered;
+	}
+	overdrawCounter.enabled = false;
+	delete lights[0];
+	std::cout << (passed ? "passed" : "FAILED") << std::endl;
+	return passed ? 0 : 1;
+}
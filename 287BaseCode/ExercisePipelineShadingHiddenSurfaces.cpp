@@ -63,6 +63,7 @@ void renderObjects() {
 }
 
 static void render() {
+	VertexOps::beginFrame();
 	frameBuffer.clearColorAndDepthBuffers();
 	int width = frameBuffer.getWindowWidth();
 	int height = frameBuffer.getWindowHeight();
@@ -1,6 +1,8 @@
 #include "FragmentOps.h"
+#include "GBuffer.h"
 
 FogParams FragmentOps::fogParams;
+GBuffer *FragmentOps::gBuffer = nullptr;
 bool FragmentOps::performDepthTest = true;
 bool FragmentOps::readonlyDepthBuffer = false;
 bool FragmentOps::readonlyColorBuffer = false;
@@ -31,7 +33,29 @@ float FogParams::fogFactor(const glm::vec3 &fragPos, const glm::vec3 &eyePos) co
 color FragmentOps::applyLighting(const Fragment &fragment, const glm::vec3 &eyePositionInWorldCoords,
 										const std::vector<LightSourcePtr> &lights,
 										const glm::mat4 &viewingMatrix) {
-	return gray;
+	Frame frame = Frame::createOrthoNormalBasis(viewingMatrix);
+	return applyLighting(fragment.worldPosition, fragment.worldNormal, *fragment.material, lights, frame);
+}
+
+/**
+ * @fn	color FragmentOps::applyLighting(const glm::vec3 &position, const glm::vec3 &normal, const Material &material, const std::vector<LightSourcePtr> &lights, const Frame &frame)
+ * @brief	Sums the illumination of a point by every light.
+ * @param	position	The point, in world coordinates.
+ * @param	normal  	The normal at the point.
+ * @param	material	The material at the point.
+ * @param	lights  	The vector of lights in the scene.
+ * @param	frame   	The camera's frame.
+ * @return	The color of the point.
+ */
+
+color FragmentOps::applyLighting(const glm::vec3 &position, const glm::vec3 &normal, const Material &material,
+									const std::vector<LightSourcePtr> &lights, const Frame &frame) {
+	color C = black;
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		// can't do shadows in object order rendering
+		C += lights[i]->illuminate(position, normal, material, frame, false);
+	}
+	return C;
 }
 
 /**
@@ -62,8 +86,9 @@ color FragmentOps::applyBlending(float alpha, const color &srcColor, const color
 }
 
 /**
- * @fn	void FragmentOps::processFragment(FrameBuffer &frameBuffer, const glm::vec3 &eyePositionInWorldCoords, const std::vector<LightSourcePtr> lights, const Fragment &fragment, const glm::mat4 &viewingMatrix)
- * @brief	Process the fragment, leaving the results in the framebuffer.
+ * @fn	void FragmentOps::processFragment(FrameBuffer &frameBuffer, const glm::vec3 &eyePositionInWorldCoords, const std::vector<LightSourcePtr> &lights, const Fragment &fragment, const glm::mat4 &viewingMatrix)
+ * @brief	Process the fragment, leaving the results in the framebuffer, or in the
+ * 			G-buffer to be lit later if there is one.
  * @param [in,out]	frameBuffer					
  * @param 		  	eyePositionInWorldCoords	The eye position in world coordinates.
  * @param 		  	lights						Vector of lights in scene.
@@ -72,7 +97,7 @@ color FragmentOps::applyBlending(float alpha, const color &srcColor, const color
  */
 
 void FragmentOps::processFragment(FrameBuffer &frameBuffer, const glm::vec3 &eyePositionInWorldCoords,
-										const std::vector<LightSourcePtr> lights,
+										const std::vector<LightSourcePtr> &lights,
 										const Fragment &fragment,
 										const glm::mat4 &viewingMatrix) {
 	const glm::vec3 &eyePos = eyePositionInWorldCoords;
@@ -83,11 +108,59 @@ void FragmentOps::processFragment(FrameBuffer &frameBuffer, const glm::vec3 &eye
 	DEBUG_PIXEL = (X == xDebug && Y == yDebug);
 	bool passDepthTest = !performDepthTest || Z < frameBuffer.getDepth(X, Y);
 	if (passDepthTest) {
-		Frame frame = Frame::createOrthoNormalBasis(viewingMatrix);
-		// can't do shadows in object order rendering
-		color C = lights[0]->illuminate(fragment.worldPosition, fragment.worldNormal, fragment.material,
-			frame, false);
-		frameBuffer.setColor(X, Y, C);
+		if (gBuffer != nullptr) {
+			gBuffer->write(X, Y, fragment);
+		} else {
+			color C = applyLighting(fragment, eyePos, lights, viewingMatrix);
+			frameBuffer.setColor(X, Y, C);
+		}
 		frameBuffer.setDepth(X, Y, Z);
 	}
+}
+
+/**
+ * @fn	void FragmentOps::shadeGBuffer(FrameBuffer &frameBuffer, const glm::vec3 &eyePositionInWorldCoords, const std::vector<LightSourcePtr> &lights, const glm::mat4 &viewingMatrix, WorkerPool *pool)
+ * @brief	The lighting pass of deferred shading: lights each pixel of the G-buffer
+ * 			where something was drawn, once, with every light, and leaves the colors
+ * 			in the framebuffer. Pixels where nothing was drawn keep their colors.
+ * @param [in,out]	frameBuffer					The framebuffer, the size of the G-buffer.
+ * @param 		  	eyePositionInWorldCoords	The eye position in world coordinates.
+ * @param 		  	lights						Vector of lights in scene.
+ * @param 		  	viewingMatrix				The viewing transformation matrix.
+ * @param [in,out]	pool						If not null, the rows are lit on its threads.
+ */
+
+void FragmentOps::shadeGBuffer(FrameBuffer &frameBuffer, const glm::vec3 &eyePositionInWorldCoords,
+								const std::vector<LightSourcePtr> &lights,
+								const glm::mat4 &viewingMatrix, WorkerPool *pool) {
+	if (gBuffer == nullptr) {
+		return;
+	}
+	const GBuffer &G = *gBuffer;
+	int width = std::min(G.getWidth(), frameBuffer.getWindowWidth());
+	int height = std::min(G.getHeight(), frameBuffer.getWindowHeight());
+	Frame frame = Frame::createOrthoNormalBasis(viewingMatrix);
+	std::atomic<long long> pixelsLit(0);
+	auto shadeRow = [&](int y) {
+		long long lit = 0;
+		for (int x = 0; x < width; x++) {
+			const Material *material = G.getMaterial(x, y);
+			if (material == nullptr) {
+				continue;
+			}
+			DEBUG_PIXEL = (x == xDebug && y == yDebug);
+			color C = applyLighting(G.getPosition(x, y), G.getNormal(x, y), *material, lights, frame);
+			frameBuffer.setColor(x, y, C);
+			lit++;
+		}
+		pixelsLit += lit;
+	};
+	if (pool != nullptr) {
+		pool->run(height, shadeRow);
+	} else {
+		for (int y = 0; y < height; y++) {
+			shadeRow(y);
+		}
+	}
+	gBuffer->pixelsLit = pixelsLit;
 }
\ No newline at end of file
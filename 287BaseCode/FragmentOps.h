@@ -1,6 +1,9 @@
 #pragma once
 #include "FrameBuffer.h"
 #include "Light.h"
+#include "WorkerPool.h"
+
+struct GBuffer;
 
 /**
  * @enum	fogType
@@ -29,7 +32,8 @@ struct FogParams {
 
 struct Fragment {
 	glm::vec3 windowPosition;
-	Material material;
+	const Material *material;	//!< the fragment's material
+	int materialIndex;			//!< index of material in the MaterialTable, or -1 if it was interpolated
 	glm::vec3 worldNormal;
 	glm::vec3 worldPosition;
 };
@@ -45,10 +49,14 @@ class FragmentOps {
 		static bool readonlyDepthBuffer;	//!< True ==> rendering will not affect depth buffer. Typically false
 		static bool readonlyColorBuffer;	//!< True ==> rendering will not affect color buffer. Typically false
 		static FogParams fogParams;			//!< Parameters controlling fog effects.
+		static GBuffer *gBuffer;			//!< If not null, fragments are stored here and lit later by shadeGBuffer.
 		static void FragmentOps::processFragment(FrameBuffer &frameBuffer, const glm::vec3 &eyePositionInWorldCoords,
-														const std::vector<LightSourcePtr> lights, 
+														const std::vector<LightSourcePtr> &lights, 
 														const Fragment &fragment,
 														const glm::mat4 &viewingMatrix);
+		static void shadeGBuffer(FrameBuffer &frameBuffer, const glm::vec3 &eyePositionInWorldCoords,
+									const std::vector<LightSourcePtr> &lights,
+									const glm::mat4 &viewingMatrix, WorkerPool *pool = nullptr);
 	protected:
 		static color FragmentOps::applyFog(const color &destColor,
 											const glm::vec3 &eyePos, const glm::vec3 &fragPos);
@@ -56,4 +64,6 @@ class FragmentOps {
 		static color FragmentOps::applyLighting(const Fragment &fragment, const glm::vec3 &eyePositionInWorldCoords,
 														const std::vector<LightSourcePtr> &lights,
 														const glm::mat4 &viewingMatrix);
+		static color applyLighting(const glm::vec3 &position, const glm::vec3 &normal, const Material &material,
+									const std::vector<LightSourcePtr> &lights, const Frame &frame);
 };
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "Utilities.h"
 #include "FrameBuffer.h"
 
@@ -8,7 +9,8 @@
  * @param	height	The height.
  */
 
-FrameBuffer::FrameBuffer(const int width, const int height) : window(width, height) {
+FrameBuffer::FrameBuffer(const int width, const int height)
+	: window(width, height), colorBuffer(nullptr), depthBuffer(nullptr) {
 	setFrameBufferSize(width, height);
 }
 
@@ -41,6 +43,12 @@ void FrameBuffer::setFrameBufferSize(int width, int height) {
 
 	colorBuffer = new GLubyte[window.area() * BYTES_PER_PIXEL];
 	depthBuffer = new float[window.area()];
+
+	depthTilesX = (width + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+	int depthTilesY = (height + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+	tileMaxDepth.resize(depthTilesX * depthTilesY);
+	tileIsStale.resize(depthTilesX * depthTilesY);
+	markDepthTilesStale();
 }
 
 /**
@@ -69,6 +77,8 @@ void FrameBuffer::clearColorAndDepthBuffers() {
 	}
 	const int SZ = window.area();
 	std::fill(depthBuffer, depthBuffer + SZ, 1.0f);
+	std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), 1.0f);
+	std::fill(tileIsStale.begin(), tileIsStale.end(), 0);
 }
 
 /**
@@ -157,7 +167,47 @@ void FrameBuffer::setDepth(float x, float y, float depth) {
 void FrameBuffer::setDepth(int x, int y, float depth) {
 	if (checkInWindow(x, y)) {
 		depthBuffer[y * window.width + x] = depth;
+		tileIsStale[(y / DEPTH_TILE_SIZE) * depthTilesX + x / DEPTH_TILE_SIZE] = 1;
+	}
+}
+
+/**
+ * @fn	float FrameBuffer::getTileMaxDepth(int tx, int ty)
+ * @brief	Gets the largest depth in a depth tile, finding it again if the tile's
+ * 			depths have changed. A fragment in the tile that is not nearer than
+ * 			this cannot pass the depth test.
+ * @param	tx	The tile's column.
+ * @param	ty	The tile's row.
+ * @return	The largest depth in the tile.
+ */
+
+float FrameBuffer::getTileMaxDepth(int tx, int ty) {
+	int tile = ty * depthTilesX + tx;
+	if (tileIsStale[tile]) {
+		int x0 = tx * DEPTH_TILE_SIZE;
+		int y0 = ty * DEPTH_TILE_SIZE;
+		int x1 = std::min(x0 + DEPTH_TILE_SIZE, window.width);
+		int y1 = std::min(y0 + DEPTH_TILE_SIZE, window.height);
+		float maxDepth = -FLT_MAX;
+		for (int y = y0; y < y1; y++) {
+			const float *row = depthBuffer + y * window.width;
+			for (int x = x0; x < x1; x++) {
+				maxDepth = std::max(maxDepth, row[x]);
+			}
+		}
+		tileMaxDepth[tile] = maxDepth;
+		tileIsStale[tile] = 0;
 	}
+	return tileMaxDepth[tile];
+}
+
+/**
+ * @fn	void FrameBuffer::markDepthTilesStale()
+ * @brief	Marks every depth tile's largest depth as needing to be found again.
+ */
+
+void FrameBuffer::markDepthTilesStale() {
+	std::fill(tileIsStale.begin(), tileIsStale.end(), 1);
 }
 
 /**
@@ -214,3 +264,50 @@ void FrameBuffer::setPixel(int x, int y, const color &C, float depth) {
 	setDepth(x, y, depth);
 	setColor(x, y, C);
 }
+
+/**
+ * @fn	void FrameBuffer::copyPixels(const FrameBuffer &source, int left, int bottom, int width, int height)
+ * @brief	Copies a rectangle of colors and depths from another frame buffer. If the
+ * 			two buffers differ in size, the rectangle is scaled by the ratio of their
+ * 			sizes, using the nearest source pixel.
+ * @param	source	The frame buffer to copy from.
+ * @param	left  	Left edge of the rectangle, in the source.
+ * @param	bottom	Bottom edge of the rectangle, in the source.
+ * @param	width 	Width of the rectangle, in the source.
+ * @param	height	Height of the rectangle, in the source.
+ */
+
+void FrameBuffer::copyPixels(const FrameBuffer &source, int left, int bottom, int width, int height) {
+	int srcW = source.window.width;
+	int srcH = source.window.height;
+	if (srcW <= 0 || srcH <= 0) {
+		return;
+	}
+	int x0 = std::max(left * window.width / srcW, 0);
+	int x1 = std::min((left + width) * window.width / srcW, window.width);
+	int y0 = std::max(bottom * window.height / srcH, 0);
+	int y1 = std::min((bottom + height) * window.height / srcH, window.height);
+	if (x0 >= x1) {
+		return;
+	}
+	markDepthTilesStale();
+	if (srcW == window.width && srcH == window.height) {
+		for (int y = y0; y < y1; ++y) {
+			int offset = x0 + y * window.width;
+			std::memcpy(colorBuffer + BYTES_PER_PIXEL * offset, source.colorBuffer + BYTES_PER_PIXEL * offset,
+						BYTES_PER_PIXEL * (x1 - x0));
+			std::memcpy(depthBuffer + offset, source.depthBuffer + offset, sizeof(float) * (x1 - x0));
+		}
+		return;
+	}
+	for (int y = y0; y < y1; ++y) {
+		int srcRow = (y * srcH / window.height) * srcW;
+		int dstRow = y * window.width;
+		for (int x = x0; x < x1; ++x) {
+			int srcIndex = srcRow + x * srcW / window.width;
+			std::memcpy(colorBuffer + BYTES_PER_PIXEL * (dstRow + x), source.colorBuffer + BYTES_PER_PIXEL * srcIndex,
+						BYTES_PER_PIXEL);
+			depthBuffer[dstRow + x] = source.depthBuffer[srcIndex];
+		}
+	}
+}
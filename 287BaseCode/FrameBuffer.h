@@ -4,12 +4,14 @@
 #include "ColorAndMaterials.h"
 
 const int BYTES_PER_PIXEL = 3;			//!< RGB requires 3 bytes.
+const int DEPTH_TILE_SIZE = 8;			//!< Side of the square tiles whose largest depth is kept.
 
 /**
  * @struct	FrameBuffer
  * @brief	Represents a framebuffer. Two identically sized 2D arrays. The color
  * 			buffer stores the colors and the depth buffer stores the corresponding
- * 			depth at each pixel.
+ * 			depth at each pixel. The largest depth in each DEPTH_TILE_SIZE square
+ * 			tile is also kept, so that hidden geometry can be rejected a tile at a time.
  */
 
 struct FrameBuffer {
@@ -31,10 +33,18 @@ struct FrameBuffer {
 	float getDepth(float x, float y) const;
 
 	void setPixel(int x, int y, const color &C, float depth);
+	void copyPixels(const FrameBuffer &source, int left, int bottom, int width, int height);
+	GLubyte *getColorBuffer() { return colorBuffer; }
+	const float *getDepthBuffer() const { return depthBuffer; }
+	float getTileMaxDepth(int tx, int ty);
 protected:
 	bool checkInWindow(int x, int y) const;
 	Window window;							//!< Dimensions of framebuffer
 	GLubyte clearColorUB[BYTES_PER_PIXEL];	//!< Clear color
 	GLubyte *colorBuffer;					//!< 2D array for holding colors
 	float *depthBuffer;						//!< 2D array for holding depths
+	int depthTilesX;						//!< Number of depth tiles across the window
+	std::vector<float> tileMaxDepth;		//!< Largest depth in each depth tile
+	std::vector<unsigned char> tileIsStale;	//!< True if a tile's depths changed since its largest was found
+	void markDepthTilesStale();
 };
@@ -0,0 +1,79 @@
+#include "GBuffer.h"
+
+/**
+ * @fn	GBuffer::GBuffer()
+ * @brief	Constructs an empty G-buffer.
+ */
+
+GBuffer::GBuffer() : pixelsLit(0), width(0), height(0) {
+}
+
+/**
+ * @fn	void GBuffer::setSize(int width, int height)
+ * @brief	Sizes the G-buffer to match a frame buffer, clearing it if the size changes.
+ * @param	width 	The width.
+ * @param	height	The height.
+ */
+
+void GBuffer::setSize(int width, int height) {
+	if (this->width == width && this->height == height) {
+		return;
+	}
+	this->width = width;
+	this->height = height;
+	normals.resize(width * height);
+	positions.resize(width * height);
+	materialIndices.resize(width * height);
+	blendedMaterials.resize(width * height);
+	clear();
+}
+
+/**
+ * @fn	void GBuffer::clear()
+ * @brief	Marks every pixel as having nothing drawn.
+ */
+
+void GBuffer::clear() {
+	std::fill(materialIndices.begin(), materialIndices.end(), -1);
+}
+
+/**
+ * @fn	void GBuffer::write(int x, int y, const Fragment &fragment)
+ * @brief	Replaces a pixel's entry with a fragment that passed the depth test.
+ * 			Different threads may write different pixels at the same time, since
+ * 			an interpolated material goes into the pixel's own slot.
+ * @param	x			The x coordinate.
+ * @param	y			The y coordinate.
+ * @param	fragment	The fragment.
+ */
+
+void GBuffer::write(int x, int y, const Fragment &fragment) {
+	if (x < 0 || x >= width || y < 0 || y >= height) {
+		return;
+	}
+	int i = y * width + x;
+	normals[i] = fragment.worldNormal;
+	positions[i] = fragment.worldPosition;
+	if (fragment.materialIndex >= 0) {
+		materialIndices[i] = fragment.materialIndex;
+	} else {
+		blendedMaterials[i] = *fragment.material;
+		materialIndices[i] = BLENDED_MATERIAL;
+	}
+}
+
+/**
+ * @fn	const Material *GBuffer::getMaterial(int x, int y) const
+ * @brief	Gets the material of a pixel's fragment.
+ * @param	x	The x coordinate.
+ * @param	y	The y coordinate.
+ * @return	The material, or nullptr if nothing was drawn at the pixel.
+ */
+
+const Material *GBuffer::getMaterial(int x, int y) const {
+	int index = materialIndices[y * width + x];
+	if (index >= 0) {
+		return &MaterialTable::get(index);
+	}
+	return index == BLENDED_MATERIAL ? &blendedMaterials[y * width + x] : nullptr;
+}
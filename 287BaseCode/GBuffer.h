@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "FragmentOps.h"
+
+/**
+ * @struct	GBuffer
+ * @brief	The geometry buffer of deferred shading: for each pixel, what lighting
+ * 			needs to know about the nearest fragment drawn there. Fragments that
+ * 			pass the depth test overwrite a pixel's entry; once the whole frame is
+ * 			drawn, each pixel is lit once, however many fragments reached it.
+ * 			A pixel holds its fragment's index in the MaterialTable. Only the
+ * 			materials of fragments that were interpolated between differing
+ * 			vertex materials are copied, into a slot of the pixel's own.
+ */
+
+struct GBuffer {
+	long long pixelsLit;	//!< pixels lit by the last lighting pass
+	GBuffer();
+	void setSize(int width, int height);
+	void clear();
+	void write(int x, int y, const Fragment &fragment);
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	const Material *getMaterial(int x, int y) const;
+	const glm::vec3 &getNormal(int x, int y) const { return normals[y * width + x]; }
+	const glm::vec3 &getPosition(int x, int y) const { return positions[y * width + x]; }
+protected:
+	int width, height;					//!< size, in pixels
+	std::vector<glm::vec3> normals;		//!< world normal at each pixel
+	std::vector<glm::vec3> positions;	//!< world position at each pixel
+	std::vector<int> materialIndices;	//!< at each pixel, an index into the MaterialTable, -1 if nothing was drawn,
+										//!< or BLENDED_MATERIAL if the material is in blendedMaterials
+	std::vector<Material> blendedMaterials;	//!< the interpolated material at each pixel, used only where
+											//!< materialIndices is BLENDED_MATERIAL
+	static const int BLENDED_MATERIAL = -2;	//!< material index of pixels whose material is interpolated
+};
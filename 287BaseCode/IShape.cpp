@@ -22,6 +22,17 @@ void IShape::getTexCoords(const glm::vec3 &pt, float &u, float &v) const {
 	u = v = 0;
 }
 
+/**
+ * @fn	bool IShape::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the shape. The default shape is unbounded.
+ * @param [in,out]	box	The bounds, if the shape is bounded.
+ * @return	True iff the shape is bounded and box was set.
+ */
+
+bool IShape::getBounds(BoundingBox3D &box) const {
+	return false;
+}
+
 /**
  * @fn	glm::vec3 IShape::movePointOffSurface(const glm::vec3 &pt, const glm::vec3 &n)
  * @brief	Compute point that is slightly off surface.
@@ -99,8 +110,23 @@ void VisibleIShape::setTexture(Image *tex) {
  */
 
 HitRecord VisibleIShape::findIntersection(const Ray &ray, const std::vector<VisibleIShapePtr> &surfaces) {
+	int index;
+	return findIntersection(ray, surfaces, index);
+}
+
+/**
+ * @fn	HitRecord VisibleIShape::findIntersection(const Ray &ray, const std::vector<VisibleIShapePtr> &surfaces, int &index)
+ * @brief	Searches for the first intersection, and reports which surface was hit.
+ * @param 		  	ray			The ray.
+ * @param 		  	surfaces	The surfaces in the scene.
+ * @param [in,out]	index   	Index of the surface that was hit, or -1 if none.
+ * @return	The closest intersection that is in front of the camera.
+ */
+
+HitRecord VisibleIShape::findIntersection(const Ray &ray, const std::vector<VisibleIShapePtr> &surfaces, int &index) {
 	HitRecord theHit;
 	theHit.t = FLT_MAX;
+	index = -1;
 
 	for (int i = 0; i < surfaces.size(); i++) {
 		HitRecord thisHit;
@@ -109,6 +135,7 @@ HitRecord VisibleIShape::findIntersection(const Ray &ray, const std::vector<Visi
 			theHit = thisHit;
 			theHit.material = surfaces[i]->material;
 			theHit.texture = surfaces[i]->texture;
+			index = i;
 			if (theHit.texture != nullptr) {
 				surfaces[i]->shape->getTexCoords(theHit.interceptPoint, theHit.u, theHit.v);
 			}
@@ -118,6 +145,39 @@ HitRecord VisibleIShape::findIntersection(const Ray &ray, const std::vector<Visi
 
 }
 
+/**
+ * @fn	HitRecord VisibleIShape::findIntersection(const Ray &ray, const std::vector<VisibleIShapePtr> &surfaces, const std::vector<int> &candidates, int &index)
+ * @brief	Searches for the first intersection among a subset of the surfaces.
+ * @param 		  	ray		  	The ray.
+ * @param 		  	surfaces  	The surfaces in the scene.
+ * @param 		  	candidates	Indices of the surfaces to test, in increasing order.
+ * @param [in,out]	index	  	Index of the surface that was hit, or -1 if none.
+ * @return	The closest intersection that is in front of the camera.
+ */
+
+HitRecord VisibleIShape::findIntersection(const Ray &ray, const std::vector<VisibleIShapePtr> &surfaces,
+											const std::vector<int> &candidates, int &index) {
+	HitRecord theHit;
+	theHit.t = FLT_MAX;
+	index = -1;
+
+	for (unsigned int j = 0; j < candidates.size(); j++) {
+		int i = candidates[j];
+		HitRecord thisHit;
+		surfaces[i]->findClosestIntersection(ray, thisHit);
+		if (thisHit.t < theHit.t && thisHit.t > 0) {
+			theHit = thisHit;
+			theHit.material = surfaces[i]->material;
+			theHit.texture = surfaces[i]->texture;
+			index = i;
+			if (theHit.texture != nullptr) {
+				surfaces[i]->shape->getTexCoords(theHit.interceptPoint, theHit.u, theHit.v);
+			}
+		}
+	}
+	return theHit;
+}
+
 /**
  * @fn	IDisk::IDisk(const glm::vec3 &pos, const glm::vec3 &normal, float rad)
  * @brief	Implicit representation of an implicit disk.
@@ -127,7 +187,9 @@ HitRecord VisibleIShape::findIntersection(const Ray &ray, const std::vector<Visi
  */
 
 IDisk::IDisk(const glm::vec3 &pos, const glm::vec3 &normal, float rad)
-	: IShape(), center(pos), n(normal), radius(rad) {
+	: IShape(), center(pos), n(glm::normalize(normal)), radius(rad) {
+	planeOffset = glm::dot(n, center);
+	radiusSquared = radius * radius;
 }
 
 /**
@@ -138,22 +200,91 @@ IDisk::IDisk(const glm::vec3 &pos, const glm::vec3 &normal, float rad)
  */
 
 void IDisk::findClosestIntersection(const Ray &ray, HitRecord &hit) const {
-	IPlane p(center, n);
-	p.findClosestIntersection(ray, hit);
-	if (glm::distance(hit.interceptPoint, center) > radius) {
-		hit.t = FLT_MAX;
+	hit.t = FLT_MAX;
+	float denom = glm::dot(ray.direction, n);
+	if (denom == 0) {
+		return;
+	}
+	float t = (planeOffset - glm::dot(ray.origin, n)) / denom;
+	if (t < 0) {
+		return;
 	}
+	glm::vec3 pt = ray.getPoint(t);
+	glm::vec3 fromCenter = pt - center;
+	if (glm::dot(fromCenter, fromCenter) > radiusSquared) {
+		return;
+	}
+	hit.t = t;
+	hit.interceptPoint = pt;
+	hit.surfaceNormal = n;
 }
 
 /**
- * @fn	ISphere::ISphere(const glm::vec3 & position, float radius)
+ * @fn	bool IDisk::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the disk.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool IDisk::getBounds(BoundingBox3D &box) const {
+	glm::vec3 N = glm::normalize(n);
+	glm::vec3 extent = radius * glm::sqrt(glm::max(glm::vec3(1.0f) - N * N, 0.0f));
+	box = BoundingBox3D(center - extent, center + extent);
+	return true;
+}
+
+/**
+ * @fn	ISphere::ISphere(const glm::vec3 & position, float R)
  * @brief	Implicit representation of a 3D sphere.
  * @param	position	The center of the sphere.
- * @param	radius  	The radius of the sphere.
+ * @param	R		  	The radius of the sphere.
  */
 
-ISphere::ISphere(const glm::vec3 &position, float radius)
-	: IQuadricSurface(QuadricParameters::sphereQParams(radius), position) {
+ISphere::ISphere(const glm::vec3 &position, float R)
+	: IQuadricSurface(QuadricParameters::sphereQParams(R), position), radius(R),
+	radiusSquared(R * R), invRadius(1.0f / R) {
+}
+
+/**
+ * @fn	void ISphere::findClosestIntersection(const Ray &ray, HitRecord &hit) const
+ * @brief	Searches for the nearest intersection, using the geometric form of the
+ * 			ray-sphere test rather than the general quadric.
+ * @param 		  	ray	The ray.
+ * @param [in,out]	hit	The hit.
+ */
+
+void ISphere::findClosestIntersection(const Ray &ray, HitRecord &hit) const {
+	hit.t = FLT_MAX;
+	glm::vec3 L = center - ray.origin;
+	float tca = glm::dot(L, ray.direction);
+	float d2 = glm::dot(L, L) - tca * tca;
+	if (d2 > radiusSquared) {
+		return;
+	}
+	float thc = std::sqrt(radiusSquared - d2);
+	float t = tca - thc;
+	if (t <= 0) {
+		t = tca + thc;
+		if (t <= 0) {
+			return;
+		}
+	}
+	hit.t = t;
+	hit.interceptPoint = ray.getPoint(t);
+	hit.surfaceNormal = (hit.interceptPoint - center) * invRadius;
+}
+
+/**
+ * @fn	bool ISphere::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the sphere.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool ISphere::getBounds(BoundingBox3D &box) const {
+	glm::vec3 extent(radius, radius, radius);
+	box = BoundingBox3D(center - extent, center + extent);
+	return true;
 }
 
 /**
@@ -228,14 +359,7 @@ void ISphere::computeAqBqCq(const Ray &ray, float &Aq, float &Bq, float &Cq) con
  */
 
 IBox::IBox(const glm::vec3 &center, const glm::vec3 &size) 
-		: IShape() {
-	glm::vec3 sizeDiv2 = 0.5f * size;
-	rects.push_back(IRect(center + glm::vec3(sizeDiv2.x, 0, 0), glm::vec3(1, 0, 0), size.y, size.z));
-	rects.push_back(IRect(center - glm::vec3(sizeDiv2.x, 0, 0), glm::vec3(-1, 0, 0), size.y, size.z));
-	rects.push_back(IRect(center + glm::vec3(0, sizeDiv2.y, 0), glm::vec3(0, 1, 0), size.x, size.z));
-	rects.push_back(IRect(center - glm::vec3(0, sizeDiv2.y, 0), glm::vec3(0, -1, 0), size.x, size.z));
-	rects.push_back(IRect(center + glm::vec3(0, 0, sizeDiv2.z), glm::vec3(0, 0, 1), size.x, size.y));
-	rects.push_back(IRect(center - glm::vec3(0, 0, sizeDiv2.z), glm::vec3(0, 0, -1), size.x, size.y));
+		: IShape(), minPt(center - 0.5f * size), maxPt(center + 0.5f * size) {
 }
 
 /**
@@ -251,19 +375,71 @@ IBox::IBox(const glm::vec3 &center, float size)
 
 /**
  * @fn	void IBox::findClosestIntersection(const Ray &ray, HitRecord &theHit) const
- * @brief	Identifies the nearest intersection
+ * @brief	Identifies the nearest intersection, using the slab method. The ray is
+ * 			clipped against the three pairs of parallel faces; it enters the box at
+ * 			the largest entry t and leaves at the smallest exit t.
  * @param 		  	ray	The ray.
  * @param [in,out]	theHit	The hit.
  */
 
 void IBox::findClosestIntersection(const Ray &ray, HitRecord &theHit) const {
-	for (unsigned int i = 0; i < rects.size(); i++) {
-		HitRecord thisHit;
-		rects[i].findClosestIntersection(ray, thisHit);
-		if (thisHit.t < theHit.t) {
-			theHit = thisHit;
+	theHit.t = FLT_MAX;
+	float tNear = -FLT_MAX;
+	float tFar = FLT_MAX;
+	int nearAxis = -1;
+	int farAxis = -1;
+	for (int i = 0; i < 3; i++) {
+		if (ray.direction[i] == 0.0f) {
+			if (ray.origin[i] <= minPt[i] || ray.origin[i] >= maxPt[i]) {
+				return;
+			}
+			continue;
+		}
+		float invD = 1.0f / ray.direction[i];
+		float t0 = (minPt[i] - ray.origin[i]) * invD;
+		float t1 = (maxPt[i] - ray.origin[i]) * invD;
+		if (t0 > t1) {
+			std::swap(t0, t1);
 		}
+		if (t0 > tNear) {
+			tNear = t0;
+			nearAxis = i;
+		}
+		if (t1 < tFar) {
+			tFar = t1;
+			farAxis = i;
+		}
+	}
+	if (tNear >= tFar || tFar < 0) {
+		return;
 	}
+	// outside the box, the ray hits the face it enters through; inside, the one it leaves through
+	int axis;
+	float sign;
+	if (tNear >= 0) {
+		theHit.t = tNear;
+		axis = nearAxis;
+		sign = ray.direction[axis] > 0 ? -1.0f : 1.0f;
+	} else {
+		theHit.t = tFar;
+		axis = farAxis;
+		sign = ray.direction[axis] > 0 ? 1.0f : -1.0f;
+	}
+	theHit.interceptPoint = ray.getPoint(theHit.t);
+	theHit.surfaceNormal = ZEROVEC;
+	theHit.surfaceNormal[axis] = sign;
+}
+
+/**
+ * @fn	bool IBox::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the box.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool IBox::getBounds(BoundingBox3D &box) const {
+	box = BoundingBox3D(minPt, maxPt);
+	return true;
 }
 
 /**
@@ -466,9 +642,24 @@ void IPlane::findIntersection(const glm::vec3 &p1, const glm::vec3 &p2, float &t
  */
 
 IRect::IRect(const glm::vec3 &position, const glm::vec3 &normal, float W, float H)
-	: width(W), height(H), center(position), n(normal), plane(position, normal) {
+	: width(W), height(H), center(position), n(glm::normalize(normal)) {
 	W2 = W / 2;
 	H2 = H / 2;
+	planeOffset = glm::dot(n, center);
+	if (std::abs(n[0]) == 1) {	// yz plane
+		uAxis = Y_AXIS;
+		vAxis = Z_AXIS;
+	} else if (std::abs(n[1]) == 1) {	// xz plane
+		uAxis = X_AXIS;
+		vAxis = Z_AXIS;
+	} else if (std::abs(n[2]) == 1) {	// xy plane
+		uAxis = X_AXIS;
+		vAxis = Y_AXIS;
+	} else {
+		glm::vec3 up = std::abs(n[1]) < 0.9f ? Y_AXIS : X_AXIS;
+		uAxis = glm::normalize(glm::cross(up, n));
+		vAxis = glm::cross(n, uAxis);
+	}
 }
 
 /**
@@ -479,22 +670,37 @@ IRect::IRect(const glm::vec3 &position, const glm::vec3 &normal, float W, float
  */
 
 void IRect::findClosestIntersection(const Ray &ray, HitRecord &hit) const {
-	plane.findClosestIntersection(ray, hit);
-	if (hit.t == FLT_MAX) return;
-
-	if (std::abs(n[0]) == 1) {	// yz plane
-		if (!inRangeExclusive(hit.interceptPoint[1], center[1] - W2, center[1] + W2) ||
-			!inRangeExclusive(hit.interceptPoint[2], center[2] - H2, center[2] + H2))
-			hit.t = FLT_MAX;
-	} else if (std::abs(n[1]) == 1) {	// xz plane
-		if (!inRangeExclusive(hit.interceptPoint[0], center[0] - W2, center[0] + W2) ||
-			!inRangeExclusive(hit.interceptPoint[2], center[2] - H2, center[2] + H2))
-			hit.t = FLT_MAX;
-	} else if (std::abs(n[2]) == 1) {	// xy plane
-		if (!inRangeExclusive(hit.interceptPoint[0], center[0] - W2, center[0] + W2) ||
-			!inRangeExclusive(hit.interceptPoint[1], center[1] - H2, center[1] + H2))
-			hit.t = FLT_MAX;
+	hit.t = FLT_MAX;
+	float denom = glm::dot(ray.direction, n);
+	if (denom == 0) {
+		return;
+	}
+	float t = (planeOffset - glm::dot(ray.origin, n)) / denom;
+	if (t < 0) {
+		return;
+	}
+	glm::vec3 pt = ray.getPoint(t);
+	glm::vec3 fromCenter = pt - center;
+	if (std::abs(glm::dot(fromCenter, uAxis)) >= W2 ||
+		std::abs(glm::dot(fromCenter, vAxis)) >= H2) {
+		return;
 	}
+	hit.t = t;
+	hit.interceptPoint = pt;
+	hit.surfaceNormal = n;
+}
+
+/**
+ * @fn	bool IRect::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the rectangle.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool IRect::getBounds(BoundingBox3D &box) const {
+	glm::vec3 extent = W2 * glm::abs(uAxis) + H2 * glm::abs(vAxis);
+	box = BoundingBox3D(center - extent, center + extent);
+	return true;
 }
 
 /**
@@ -549,6 +755,24 @@ bool IConvexPolygon::isInside(const glm::vec3 &point) const {
 	return insideOnFrontSide || insideOnBackSide;
 }
 
+/**
+ * @fn	bool IConvexPolygon::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the polygon.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool IConvexPolygon::getBounds(BoundingBox3D &box) const {
+	glm::vec3 lo = v[0];
+	glm::vec3 hi = v[0];
+	for (unsigned int i = 1; i < v.size(); i++) {
+		lo = glm::min(lo, v[i]);
+		hi = glm::max(hi, v[i]);
+	}
+	box = BoundingBox3D(lo, hi);
+	return true;
+}
+
 /**
  * @fn	IQuadricSurface::IQuadricSurface(const QuadricParameters &params, const glm::vec3 &position)
  * @brief	Constructs an implicit representation of a QuadricSurface.
@@ -672,23 +896,19 @@ int IQuadricSurface::findIntersections(const Ray &ray, HitRecord hits[2]) const
  */
 
 void IQuadricSurface::findClosestIntersection(const Ray &ray, HitRecord &hit) const {
-	static HitRecord hits[2];
+	float Aq, Bq, Cq;
+	computeAqBqCq(ray, Aq, Bq, Cq);
+	float roots[2];
+	int numRoots = quadratic(Aq, Bq, Cq, roots);
 	hit.t = FLT_MAX;
 
-	int numIntercepts = findIntersections(ray, hits);
-	if (numIntercepts == 1 && hits[0].t > 0) {
-		hit.t = hits[0].t;
-		hit.interceptPoint = hits[0].interceptPoint;
-		hit.surfaceNormal = normal(hit.interceptPoint);
-	} else if (numIntercepts == 2) {
-		if (hits[0].t > 0) {
-			hit.t = hits[0].t;
-			hit.interceptPoint = hits[0].interceptPoint;
-			hit.surfaceNormal = normal(hit.interceptPoint);
-		} else if (hits[1].t > 0) {
-			hit.t = hits[1].t;
-			hit.interceptPoint = hits[1].interceptPoint;
+	// the roots are in ascending order, so the first positive one is the closest
+	for (int i = 0; i < numRoots; i++) {
+		if (roots[i] > 0) {
+			hit.t = roots[i];
+			hit.interceptPoint = ray.getPoint(hit.t);
 			hit.surfaceNormal = normal(hit.interceptPoint);
+			return;
 		}
 	}
 }
@@ -729,7 +949,69 @@ glm::vec3 IQuadricSurface::normal(const glm::vec3 &P) const {
 
 ICylinder::ICylinder(const glm::vec3 &pos, float R, float L,
 					const QuadricParameters &qParams)
-	: IQuadricSurface(qParams, pos), radius(R), length(L) {
+	: IQuadricSurface(qParams, pos), radius(R), length(L),
+	halfLength(L / 2.0f), radiusSquared(R * R), invRadius(1.0f / R) {
+}
+
+/**
+ * @fn	bool ICylinder::findSideIntersection(const Ray &ray, int axis, HitRecord &hit) const
+ * @brief	Intersects the ray with the open side of an axis-aligned cylinder. The ray is
+ * 			clipped to the slab between the cylinder's ends, and then intersected with the
+ * 			circle in the plane perpendicular to the axis.
+ * @param 		  	ray 	The ray.
+ * @param 		  	axis	The cylinder's axis (0 for x, 1 for y, 2 for z).
+ * @param [in,out]	hit 	The hit.
+ * @return	True iff the ray hits the side in front of its origin.
+ */
+
+bool ICylinder::findSideIntersection(const Ray &ray, int axis, HitRecord &hit) const {
+	int i = (axis + 1) % 3;
+	int j = (axis + 2) % 3;
+	hit.t = FLT_MAX;
+
+	float oa = ray.origin[axis] - center[axis];
+	float da = ray.direction[axis];
+	float tNear = 0.0f;
+	float tFar = FLT_MAX;
+	if (da != 0.0f) {
+		float invDa = 1.0f / da;
+		float t0 = (-halfLength - oa) * invDa;
+		float t1 = (halfLength - oa) * invDa;
+		tNear = std::max(tNear, std::min(t0, t1));
+		tFar = std::max(t0, t1);
+	} else if (oa <= -halfLength || oa >= halfLength) {
+		return false;
+	}
+
+	float oi = ray.origin[i] - center[i];
+	float oj = ray.origin[j] - center[j];
+	float di = ray.direction[i];
+	float dj = ray.direction[j];
+	float a = di * di + dj * dj;
+	if (a == 0.0f) {
+		return false;
+	}
+	float halfB = oi * di + oj * dj;
+	float c = oi * oi + oj * oj - radiusSquared;
+	float discriminant = halfB * halfB - a * c;
+	if (discriminant < 0) {
+		return false;
+	}
+	float root = std::sqrt(discriminant);
+	float invA = 1.0f / a;
+	float roots[2] = { (-halfB - root) * invA, (-halfB + root) * invA };
+	for (int k = 0; k < 2; k++) {
+		const float &t = roots[k];
+		if (t > tNear && t < tFar) {
+			hit.t = t;
+			hit.interceptPoint = ray.getPoint(t);
+			hit.surfaceNormal[axis] = 0.0f;
+			hit.surfaceNormal[i] = (oi + t * di) * invRadius;
+			hit.surfaceNormal[j] = (oj + t * dj) * invRadius;
+			return true;
+		}
+	}
+	return false;
 }
 
 /**
@@ -786,18 +1068,20 @@ ICylinderX::ICylinderX(const glm::vec3 &pos, float rad, float len)
 }
 
 void ICylinderX::findClosestIntersection(const Ray &ray, HitRecord &hit) const{
-	const glm::vec3 &rayOrigin = ray.origin;
-	const glm::vec3 &rayDirection = ray.direction;
-	static HitRecord hits[2];
-	int numHits = ICylinder::findIntersections(ray, hits);
-	for (int i = 0; i < numHits; i++) {
-		if (hits[i].interceptPoint.x < center.x + length / 2 &&
-			hits[i].interceptPoint.x > center.x - length / 2) {
-			hit = hits[i];
-			return;
-		}
-	}
-	hit.t = FLT_MAX;
+	findSideIntersection(ray, 0, hit);
+}
+
+/**
+ * @fn	bool ICylinderX::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the cylinder.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool ICylinderX::getBounds(BoundingBox3D &box) const {
+	glm::vec3 extent(length / 2.0f, radius, radius);
+	box = BoundingBox3D(center - extent, center + extent);
+	return true;
 }
 
 void ICylinderX::getTexCoords(const glm::vec3 &pt, float &u, float &v) const {
@@ -827,18 +1111,20 @@ ICylinderY::ICylinderY(const glm::vec3 &pos, float rad, float len)
  */
 
 void ICylinderY::findClosestIntersection(const Ray &ray, HitRecord &hit) const {
-	const glm::vec3 &rayOrigin = ray.origin;
-	const glm::vec3 &rayDirection = ray.direction;
-	static HitRecord hits[2];
-	int numHits = ICylinder::findIntersections(ray, hits);
-	for (int i = 0; i < numHits; i++) {
-		if (hits[i].interceptPoint.y < center.y + length / 2 &&
-			hits[i].interceptPoint.y > center.y - length / 2) {
-				hit = hits[i];
-				return;
-		}
-	}
-	hit.t = FLT_MAX;
+	findSideIntersection(ray, 1, hit);
+}
+
+/**
+ * @fn	bool ICylinderY::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the cylinder.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool ICylinderY::getBounds(BoundingBox3D &box) const {
+	glm::vec3 extent(radius, length / 2.0f, radius);
+	box = BoundingBox3D(center - extent, center + extent);
+	return true;
 }
 
 IClosedCylinderY::IClosedCylinderY(const glm::vec3 &pos, float rad, float len)
@@ -846,19 +1132,33 @@ IClosedCylinderY::IClosedCylinderY(const glm::vec3 &pos, float rad, float len)
 	
 }
 
+/**
+ * @fn	void IClosedCylinderY::findClosestIntersection(const Ray &ray, HitRecord &hit) const
+ * @brief	Searches for the nearest intersection with the side or either cap.
+ * @param 		  	ray	The ray.
+ * @param [in,out]	hit	The hit.
+ */
+
 void IClosedCylinderY::findClosestIntersection(const Ray &ray, HitRecord &hit) const {
-	const glm::vec3 &rayOrigin = ray.origin;
-	const glm::vec3 &rayDirection = ray.direction;
-	static HitRecord hits[2];
-	int numHits = ICylinder::findIntersections(ray, hits);
-	for (int i = 0; i < numHits; i++) {
-		if (hits[i].interceptPoint.y < center.y + length / 2 &&
-		hits[i].interceptPoint.y > center.y - length / 2){
-			hit = hits[i];
-			return;
+	findSideIntersection(ray, 1, hit);
+	if (ray.direction.y == 0.0f) {
+		return;
+	}
+	float invDy = 1.0f / ray.direction.y;
+	const float sides[2] = { 1.0f, -1.0f };
+	for (int k = 0; k < 2; k++) {
+		float t = (center.y + sides[k] * halfLength - ray.origin.y) * invDy;
+		if (t <= 0 || t >= hit.t) {
+			continue;
+		}
+		float x = ray.origin.x + t * ray.direction.x - center.x;
+		float z = ray.origin.z + t * ray.direction.z - center.z;
+		if (x * x + z * z <= radiusSquared) {
+			hit.t = t;
+			hit.interceptPoint = ray.getPoint(t);
+			hit.surfaceNormal = glm::vec3(0, sides[k], 0);
 		}
 	}
-	hit.t = FLT_MAX;
 }
 
 //use quadric surfaces to implement cone
@@ -926,6 +1226,18 @@ void ITriangle::findClosestIntersection(const Ray &ray, HitRecord &hit) const {
 	}
 }
 
+/**
+ * @fn	bool ITriangle::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the triangle.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool ITriangle::getBounds(BoundingBox3D &box) const {
+	box = BoundingBox3D(glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)));
+	return true;
+}
+
 /**
  * @fn	IEllipsoid::IEllipsoid(const glm::vec3 &position, const glm::vec3 &sz) : IQuadricSurface(QuadricParameters::ellipoidParameters(sz), position)
  * @brief	Constructs an implicit representation of an ellipsoid.
@@ -937,6 +1249,19 @@ IEllipsoid::IEllipsoid(const glm::vec3 &position, const glm::vec3 &sz)
 	: IQuadricSurface(QuadricParameters::ellipsoidQParams(sz), position) {
 }
 
+/**
+ * @fn	bool IEllipsoid::getBounds(BoundingBox3D &box) const
+ * @brief	Gets the axis-aligned bounds of the ellipsoid.
+ * @param [in,out]	box	The bounds.
+ * @return	True.
+ */
+
+bool IEllipsoid::getBounds(BoundingBox3D &box) const {
+	glm::vec3 extent(1.0f / std::sqrt(qParams.A), 1.0f / std::sqrt(qParams.B), 1.0f / std::sqrt(qParams.C));
+	box = BoundingBox3D(center - extent, center + extent);
+	return true;
+}
+
 /**
  * @fn	void IEllipsoid::computeAqBqCq(const Ray &ray, float &Aq, float &Bq, float &Cq) const
  * @brief	Calculates the aq bq cq, given a particular ray.
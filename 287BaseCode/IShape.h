@@ -18,6 +18,9 @@ struct Ray {
 	Ray(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection) :
 		origin(rayOrigin), direction(glm::normalize(rayDirection)) {
 	}
+	Ray(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection, bool isNormalized) :
+		origin(rayOrigin), direction(isNormalized ? rayDirection : glm::normalize(rayDirection)) {
+	}
 	glm::vec3 getPoint(float t) const {
 		return origin + t * direction;
 	}
@@ -30,8 +33,11 @@ struct Ray {
 
 struct IShape {
 	IShape();
+	virtual ~IShape() {}
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const = 0;
 	virtual void getTexCoords(const glm::vec3 &pt, float &u, float &v) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
+	virtual IShape *clone() const = 0;
 	static glm::vec3 movePointOffSurface(const glm::vec3 &pt, const glm::vec3 &n);
 };
 
@@ -53,6 +59,9 @@ struct VisibleIShape {
 	void setTexture(Image *tex, float leftU, float rightU, float bottomV, float topV);
 	void setTexture(Image *tex);
 	static HitRecord findIntersection(const Ray &ray, const std::vector<VisibleIShapePtr> &surfaces);
+	static HitRecord findIntersection(const Ray &ray, const std::vector<VisibleIShapePtr> &surfaces, int &index);
+	static HitRecord findIntersection(const Ray &ray, const std::vector<VisibleIShapePtr> &surfaces,
+										const std::vector<int> &candidates, int &index);
 };
 
 /**
@@ -69,6 +78,7 @@ struct IPlane : public IShape {
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
 	bool insidePlane(const glm::vec3 &point) const;
 	void findIntersection(const glm::vec3 &p1, const glm::vec3 &p2, float &t) const;
+	virtual IShape *clone() const { return new IPlane(*this); }
 };
 
 /**
@@ -80,9 +90,14 @@ struct IPlane : public IShape {
 struct IDisk : public IShape {
 	IDisk(const glm::vec3 &position, const glm::vec3 &n, float rad);
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
+	virtual IShape *clone() const { return new IDisk(*this); }
 	glm::vec3 center;	//!< center point of disk
 	glm::vec3 n;		//!< normal vector of disk
 	float radius;
+protected:
+	float planeOffset;		//!< dot(n, center)
+	float radiusSquared;	//!< radius*radius
 };
 
 
@@ -95,6 +110,8 @@ struct IDisk : public IShape {
 struct IRect : public IShape {
 	IRect(const glm::vec3 &position, const glm::vec3 &normal, float W, float H);
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
+	virtual IShape *clone() const { return new IRect(*this); }
 	float width;		//!< width of rectangle
 	float height;		//!< height of rectangle
 	glm::vec3 center;	//!< center point of rectangle
@@ -102,7 +119,9 @@ protected:
 	float W2;			//!< width/2
 	float H2;			//!< height/2
 	glm::vec3 n;		//!< normal vector of rectangle
-	IPlane plane;		//!< infinite plane that subsumes the given finite plane
+	float planeOffset;	//!< dot(n, center)
+	glm::vec3 uAxis;	//!< unit vector along the width of the rectangle
+	glm::vec3 vAxis;	//!< unit vector along the height of the rectangle
 };
 
 /**
@@ -114,8 +133,11 @@ struct IBox : public IShape {
 	IBox(const glm::vec3 &center, const glm::vec3 &size);
 	IBox(const glm::vec3 &center, float size);
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
+	virtual IShape *clone() const { return new IBox(*this); }
 protected:
-	std::vector<IRect> rects;	//!< 6 rectangles corresponding to sides of box.
+	glm::vec3 minPt;	//!< corner with the smallest x, y and z values
+	glm::vec3 maxPt;	//!< corner with the largest x, y and z values
 };
 
 /**
@@ -146,7 +168,9 @@ struct IConvexPolygon : public IPlane {
 	glm::vec3 n;
 	IConvexPolygon(const std::vector<glm::vec3> &vertices);
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
 	bool isInside(const glm::vec3 &point) const;
+	virtual IShape *clone() const { return new IConvexPolygon(*this); }
 };
 
 /**
@@ -161,7 +185,9 @@ struct ITriangle : public IShape {
 	IPlane plane;	//!< the plane this triangle lies on.
 	ITriangle(const glm::vec3 &A, const glm::vec3 &B, const glm::vec3 &C);
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
 	bool inside(const glm::vec3 &pt) const;
+	virtual IShape *clone() const { return new ITriangle(*this); }
 };
 
 /**
@@ -181,6 +207,7 @@ struct IQuadricSurface : public IShape {
 	int findIntersections(const Ray &ray, HitRecord hits[2]) const;
 	glm::vec3 normal(const glm::vec3 &pt) const;
 	virtual void computeAqBqCq(const Ray &ray, float &Aq, float &Bq, float &Cq) const;
+	virtual IShape *clone() const { return new IQuadricSurface(*this); }
 protected:
 	QuadricParameters qParams;		//!< The parameters that make up the quadric
 	float twoA;						//!< 2*A
@@ -194,9 +221,16 @@ protected:
  */
 
 struct ISphere : IQuadricSurface {
+	float radius;		//!< radius of sphere
 	ISphere(const glm::vec3 &position, float radius);
+	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
 	virtual void getTexCoords(const glm::vec3 &pt, float &u, float &v) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
 	virtual void computeAqBqCq(const Ray &ray, float &Aq, float &Bq, float &Cq) const;
+	virtual IShape *clone() const { return new ISphere(*this); }
+protected:
+	float radiusSquared;	//!< radius*radius
+	float invRadius;		//!< 1/radius
 };
 
 /**
@@ -209,12 +243,19 @@ struct ICylinder : public IQuadricSurface {
 	ICylinder(const glm::vec3 &position, float R, float len, const QuadricParameters &qParams);
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const = 0;
 	virtual void computeAqBqCq(const Ray &ray, float &Aq, float &Bq, float &Cq) const;
+protected:
+	float halfLength;		//!< length/2
+	float radiusSquared;	//!< radius*radius
+	float invRadius;		//!< 1/radius
+	bool findSideIntersection(const Ray &ray, int axis, HitRecord &hit) const;
 };
 
 struct ICylinderX : public ICylinder {
 	ICylinderX(const glm::vec3 &position, float R, float len);
 	virtual void findClosestIntersection(const Ray&ray, HitRecord &hit) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
 	void getTexCoords(const glm::vec3 &pt, float &u, float &v) const;
+	virtual IShape *clone() const { return new ICylinderX(*this); }
 };
 
 /**
@@ -225,7 +266,9 @@ struct ICylinderX : public ICylinder {
 struct ICylinderY : public ICylinder {
 	ICylinderY(const glm::vec3 &position, float R, float len);
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
+	virtual bool getBounds(BoundingBox3D &box) const;
 	void getTexCoords(const glm::vec3 &pt, float &u, float &v) const;
+	virtual IShape *clone() const { return new ICylinderY(*this); }
 };
 
 /**
@@ -237,6 +280,7 @@ struct IClosedCylinderY : public ICylinderY {
 	IClosedCylinderY(const glm::vec3 &position, float R, float len);
 	IDisk top, bottom;
 	virtual void findClosestIntersection(const Ray &ray, HitRecord &hit) const;
+	virtual IShape *clone() const { return new IClosedCylinderY(*this); }
 };
 
 /**
@@ -246,5 +290,7 @@ struct IClosedCylinderY : public ICylinderY {
 
 struct IEllipsoid : public IQuadricSurface {
 	IEllipsoid(const glm::vec3 &position, const glm::vec3 &sz);
+	virtual bool getBounds(BoundingBox3D &box) const;
 	virtual void computeAqBqCq(const Ray &ray, float &Aq, float &Bq, float &Cq) const;
+	virtual IShape *clone() const { return new IEllipsoid(*this); }
 };
\ No newline at end of file
@@ -142,6 +142,50 @@ color SpotLight::illuminate(const glm::vec3 &interceptWorldCoords,
 	}
 }
 
+/**
+ * @fn	bool PositionalLight::mayIlluminate(const BoundingBox3D &box) const
+ * @brief	Determines if this light may reach some point of a box. A positional
+ * 			light reaches everywhere when it is on.
+ * @param	box	The box.
+ * @return	False if no point in the box can be lit by this light.
+ */
+
+bool PositionalLight::mayIlluminate(const BoundingBox3D &box) const {
+	return isOn;
+}
+
+/**
+ * @fn	bool SpotLight::mayIlluminate(const BoundingBox3D &box) const
+ * @brief	Determines if this light's cone may reach some point of a box. The
+ * 			directions from the light to the box are bounded by the cone around the
+ * 			box's bounding sphere, and tested against the same cone predicate used
+ * 			by illuminate.
+ * @param	box	The box.
+ * @return	False if no point in the box can be lit by this light.
+ */
+
+bool SpotLight::mayIlluminate(const BoundingBox3D &box) const {
+	if (!isOn) {
+		return false;
+	}
+	glm::vec3 center = 0.5f * (box.minCorner() + box.maxCorner());
+	float radius = 0.5f * glm::distance(box.minCorner(), box.maxCorner());
+	float dist = glm::distance(center, lightPosition);
+	float dirLength = glm::length(spotDirection);
+	if (dist <= radius || dirLength > M_PI) {
+		return true;
+	}
+	// directions to the box lie within halfAngle of the direction to its center
+	float halfAngle = std::asin(radius / dist);
+	float toCenter = std::acos(glm::clamp(glm::dot((center - lightPosition) / dist, spotDirection / dirLength),
+											-1.0f, 1.0f));
+	float dotLow = dirLength * std::cos(std::min(toCenter + halfAngle, M_PI));
+	float dotHigh = dirLength * std::cos(std::max(toCenter - halfAngle, 0.0f));
+	// illuminate lights a direction when cos(dot) < fov, and cos falls as |dot| grows
+	float largestDot = std::max(std::abs(dotLow), std::abs(dotHigh));
+	return std::cos(largestDot) < fov;
+}
+
 /**
 * @fn	ostream &operator << (std::ostream &os, const LightAttenuationParameters &at)
 * @brief	Output stream for light attenuation parameters.
@@ -53,6 +53,7 @@ struct LightSource {
 	LightSource() {
 		isOn = true;
 	}
+	virtual ~LightSource() {}
 	virtual color illuminate(const glm::vec3 &interceptWorldCoords,
 								const glm::vec3 &normal, 
 								const Material &material,
@@ -87,6 +88,8 @@ struct PositionalLight : public LightSource {
 							const glm::vec3 &normal,
 							const Material &material,
 							const Frame &eyeFrame, bool inShadow) const;
+	virtual bool mayIlluminate(const BoundingBox3D &box) const;
+	virtual PositionalLight *clone() const { return new PositionalLight(*this); }
 	friend std::ostream &operator << (std::ostream &os, const PositionalLight &pl);
 };
 
@@ -107,6 +110,8 @@ struct SpotLight : public PositionalLight {
 							const glm::vec3 &normal,
 							const Material &material,
 							const Frame &eyeFrame, bool inShadow) const;
+	virtual bool mayIlluminate(const BoundingBox3D &box) const;
+	virtual PositionalLight *clone() const { return new SpotLight(*this); }
 	friend std::ostream &operator << (std::ostream &os, const SpotLight &pl);
 };
 
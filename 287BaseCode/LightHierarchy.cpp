@@ -0,0 +1,196 @@
+#include <algorithm>
+#include "LightHierarchy.h"
+
+// a light's diffuse and specular contributions are ignored where they fall below this.
+static const float LIGHT_CUTOFF = 1.0f / 256.0f;
+
+// most lights in a leaf of the hierarchy.
+static const int LIGHTS_PER_LEAF = 4;
+
+/**
+ * @fn	LightNode::LightNode(const BoundingBox3D &bounds)
+ * @brief	Constructs a leaf with no lights.
+ * @param	bounds	The bounds of the node.
+ */
+
+LightNode::LightNode(const BoundingBox3D &bounds)
+	: box(bounds), left(-1), right(-1), first(0), count(0) {
+}
+
+/**
+ * @fn	LightHierarchy::LightHierarchy()
+ * @brief	Constructs an empty hierarchy.
+ */
+
+LightHierarchy::LightHierarchy() : boundedAmbient(black), numLightsOn(0) {
+}
+
+/**
+ * @fn	float LightHierarchy::peakIntensity(const PositionalLight &light)
+ * @brief	Bounds the unattenuated diffuse plus specular contribution of a light.
+ * 			Materials scale the light's colors by at most one, so the brightest
+ * 			components of the light's colors bound it.
+ * @param	light	The light.
+ * @return	The bound.
+ */
+
+float LightHierarchy::peakIntensity(const PositionalLight &light) {
+	const LightColor &lc = light.lightColorComponents;
+	return std::max(std::max(lc.diffuse.r, lc.diffuse.g), lc.diffuse.b) +
+			std::max(std::max(lc.specular.r, lc.specular.g), lc.specular.b);
+}
+
+/**
+ * @fn	float LightHierarchy::influenceRadius(const PositionalLight &light)
+ * @brief	Computes the distance beyond which a light's attenuated diffuse and
+ * 			specular contributions are below LIGHT_CUTOFF.
+ * @param	light	The light.
+ * @return	The radius, or FLT_MAX if the light is not attenuated with distance.
+ */
+
+float LightHierarchy::influenceRadius(const PositionalLight &light) {
+	const LightAttenuationParameters &at = light.attenuationParams;
+	if (!light.attenuationIsTurnedOn || (at.linear <= 0.0f && at.quadratic <= 0.0f)) {
+		return FLT_MAX;
+	}
+	// solve constant + linear*d + quadratic*d^2 = peakIntensity / LIGHT_CUTOFF
+	float c = at.constant - peakIntensity(light) / LIGHT_CUTOFF;
+	float d;
+	if (at.quadratic > 0.0f) {
+		d = (-at.linear + std::sqrt(at.linear * at.linear - 4.0f * at.quadratic * c)) / (2.0f * at.quadratic);
+	} else {
+		d = -c / at.linear;
+	}
+	return std::max(d, 0.0f);
+}
+
+/**
+ * @fn	void LightHierarchy::build(const std::vector<PositionalLightPtr> &lights, bool boundLights)
+ * @brief	Rebuilds the hierarchy over a scene's lights. Lights that are off are
+ * 			left out altogether.
+ * @param	lights	   	The lights.
+ * @param	boundLights	False to treat every light as reaching everywhere, so that
+ * 						every light is evaluated at every point.
+ */
+
+void LightHierarchy::build(const std::vector<PositionalLightPtr> &lights, bool boundLights) {
+	nodes.clear();
+	order.clear();
+	globalLights.clear();
+	centers.resize(lights.size());
+	radii.resize(lights.size());
+	ambients.resize(lights.size());
+	boundedAmbient = black;
+	numLightsOn = 0;
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		const PositionalLight &light = *lights[i];
+		centers[i] = light.lightPosition;
+		ambients[i] = light.lightColorComponents.ambient;
+		radii[i] = FLT_MAX;
+		if (!light.isOn) {
+			continue;
+		}
+		numLightsOn++;
+		// a spot light's ambient color depends on its cone, so it cannot be summed
+		if (boundLights && dynamic_cast<const SpotLight *>(&light) == nullptr) {
+			radii[i] = influenceRadius(light);
+		}
+		if (radii[i] == FLT_MAX) {
+			globalLights.push_back(i);
+		} else {
+			order.push_back(i);
+			boundedAmbient += ambients[i];
+		}
+	}
+	if (!order.empty()) {
+		buildNode(0, (int)order.size());
+	}
+}
+
+/**
+ * @fn	int LightHierarchy::buildNode(int first, int count)
+ * @brief	Builds the node over a run of the bounded lights, splitting it at the
+ * 			median light along the widest axis of the lights' positions.
+ * @param	first	Start of the run in order.
+ * @param	count	Number of lights in the run.
+ * @return	Index of the new node.
+ */
+
+int LightHierarchy::buildNode(int first, int count) {
+	glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+	glm::vec3 centerLo(FLT_MAX), centerHi(-FLT_MAX);
+	for (int j = first; j < first + count; j++) {
+		int i = order[j];
+		lo = glm::min(lo, centers[i] - glm::vec3(radii[i]));
+		hi = glm::max(hi, centers[i] + glm::vec3(radii[i]));
+		centerLo = glm::min(centerLo, centers[i]);
+		centerHi = glm::max(centerHi, centers[i]);
+	}
+	int index = (int)nodes.size();
+	nodes.push_back(LightNode(BoundingBox3D(lo, hi)));
+	if (count <= LIGHTS_PER_LEAF) {
+		nodes[index].first = first;
+		nodes[index].count = count;
+		return index;
+	}
+	glm::vec3 extent = centerHi - centerLo;
+	int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+	int half = count / 2;
+	std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+					[&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+	int left = buildNode(first, half);
+	int right = buildNode(first + half, count - half);
+	nodes[index].left = left;
+	nodes[index].right = right;
+	return index;
+}
+
+/**
+ * @fn	void LightHierarchy::findLights(const glm::vec3 &pt, std::vector<int> &indices) const
+ * @brief	Finds the bounded lights whose influence spheres contain a point.
+ * @param 		  	pt	   	The point.
+ * @param [in,out]	indices	Receives the indices of the lights, into the scene's lights.
+ */
+
+void LightHierarchy::findLights(const glm::vec3 &pt, std::vector<int> &indices) const {
+	indices.clear();
+	if (nodes.empty()) {
+		return;
+	}
+	int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const LightNode &node = nodes[stack[--top]];
+		if (!node.box.contains(pt)) {
+			continue;
+		}
+		if (node.left < 0) {
+			for (int j = node.first; j < node.first + node.count; j++) {
+				int i = order[j];
+				glm::vec3 d = pt - centers[i];
+				if (glm::dot(d, d) <= radii[i] * radii[i]) {
+					indices.push_back(i);
+				}
+			}
+		} else {
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+}
+
+/**
+ * @fn	color LightHierarchy::ambientBeyond(const std::vector<int> &nearLights) const
+ * @brief	Sums the ambient colors of the bounded lights that do not reach a point.
+ * @param	nearLights	The bounded lights that reach the point, from findLights.
+ * @return	The summed ambient color of the other bounded lights.
+ */
+
+color LightHierarchy::ambientBeyond(const std::vector<int> &nearLights) const {
+	color result = boundedAmbient;
+	for (unsigned int j = 0; j < nearLights.size(); j++) {
+		result -= ambients[nearLights[j]];
+	}
+	return result;
+}
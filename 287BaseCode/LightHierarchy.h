@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include "Light.h"
+
+/**
+ * @struct	LightNode
+ * @brief	A node of a light hierarchy. Leaves hold a run of lights; the box of
+ * 			every node bounds the influence spheres of the lights below it.
+ */
+
+struct LightNode {
+	BoundingBox3D box;	//!< bounds of the influence spheres below this node
+	int left, right;	//!< children, or -1 for a leaf
+	int first, count;	//!< the leaf's lights, as a run of LightHierarchy::order
+	LightNode(const BoundingBox3D &bounds);
+};
+
+/**
+ * @struct	LightHierarchy
+ * @brief	A bounding volume hierarchy over the lights of a scene, so that a
+ * 			shading point only evaluates the lights that reach it. An attenuated
+ * 			positional light is bounded by the sphere beyond which its diffuse and
+ * 			specular contributions fall below LIGHT_CUTOFF; outside it, the light
+ * 			only adds its ambient color, which is summed once per build. Spot lights
+ * 			and lights without attenuation reach everywhere and are always evaluated.
+ */
+
+struct LightHierarchy {
+	LightHierarchy();
+	void build(const std::vector<PositionalLightPtr> &lights, bool boundLights);
+	void findLights(const glm::vec3 &pt, std::vector<int> &indices) const;
+	const std::vector<int> &getGlobalLights() const { return globalLights; }
+	color ambientBeyond(const std::vector<int> &nearLights) const;
+	float getRadius(int light) const { return radii[light]; }
+	bool anyLightIsOn() const { return numLightsOn > 0; }
+	static float influenceRadius(const PositionalLight &light);
+	static float peakIntensity(const PositionalLight &light);
+protected:
+	std::vector<LightNode> nodes;	//!< the hierarchy; nodes[0] is the root
+	std::vector<int> order;			//!< the bounded lights, grouped by leaf
+	std::vector<glm::vec3> centers;	//!< position of each light
+	std::vector<float> radii;		//!< influence radius of each light (FLT_MAX if unbounded)
+	std::vector<color> ambients;	//!< ambient color of each light
+	std::vector<int> globalLights;	//!< the lights that are on and reach everywhere
+	color boundedAmbient;			//!< sum of the ambient colors of the bounded lights
+	int numLightsOn;				//!< number of lights that are on
+	int buildNode(int first, int count);
+};
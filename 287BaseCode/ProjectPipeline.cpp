@@ -11,6 +11,8 @@
 #include "Camera.h"
 #include "Utilities.h"
 #include "VertexOps.h"
+#include "EdgeAntialiaser.h"
+#include "GBuffer.h"
 
 PositionalLightPtr theLight = new PositionalLight(glm::vec3(2, 1, 3), pureWhiteLight);
 std::vector<LightSourcePtr> lights = { theLight };
@@ -25,11 +27,16 @@ bool twoViewOn = false;
 const float SPEED = 0.1;
 
 FrameBuffer frameBuffer(WINDOW_WIDTH, WINDOW_HEIGHT);
+WorkerPool rasterPool;
+EdgeAntialiaser edgeAntialiaser;
+bool edgeAntialiasingOn = false;
+GBuffer gBuffer;
+bool deferredShadingOn = false;
 
 //EShapeData plane = EShape::createECheckerBoard(copper, tin, 10, 10, 10);
-EShapeData plane = EShape::createECheckerBoard(silver, blackPlastic, 10, 10, 10);
-EShapeData cone = EShape::createECone(silver, 2, 1, 60, 0);
-EShapeData cyl = EShape::createECylinder(silver, 5, 10, 60, 0);
+IndexedMesh plane(EShape::createECheckerBoard(silver, blackPlastic, 10, 10, 10));
+IndexedMesh cone(EShape::createECone(silver, 2, 1, 60, 0));
+IndexedMesh cyl(EShape::createECylinder(silver, 5, 10, 60, 0));
 
 void renderObjects() {
 	VertexOps::render(frameBuffer, plane, lights, glm::mat3());
@@ -38,6 +45,7 @@ void renderObjects() {
 }
 
 static void render() {
+	VertexOps::beginFrame();
 	frameBuffer.clearColorAndDepthBuffers();
 	int width = frameBuffer.getWindowWidth();
 	int height = frameBuffer.getWindowHeight();
@@ -45,7 +53,30 @@ static void render() {
 	float AR = (float)width / height;
 	VertexOps::projectionTransformation = glm::perspective(glm::radians(125.0), 2.0, 0.1, 5.0);
 	VertexOps::setViewport(0, width - 1, 0, height - 1);
+	if (deferredShadingOn) {
+		gBuffer.setSize(width, height);
+		gBuffer.clear();
+		FragmentOps::gBuffer = &gBuffer;
+	}
 	renderObjects();
+	if (deferredShadingOn) {
+		VertexOps::shadeDeferred(frameBuffer, lights);
+		FragmentOps::gBuffer = nullptr;
+	}
+	if (overdrawCounter.enabled) {
+		std::cout << "Pixels covered: " << overdrawCounter.pixelsCovered
+					<< ", covered again by the same object: " << overdrawCounter.extraCoverage << std::endl;
+		std::cout << "Hidden depth tiles: " << occlusionStats.tilesHidden << " of " << occlusionStats.tilesTested
+					<< ", hidden triangles: " << occlusionStats.trianglesHidden << " of " << occlusionStats.trianglesTested
+					<< std::endl;
+		if (deferredShadingOn) {
+			std::cout << "Pixels lit by the deferred pass: " << gBuffer.pixelsLit << std::endl;
+		}
+		overdrawCounter.enabled = false;
+	}
+	if (edgeAntialiasingOn) {
+		edgeAntialiaser.apply(frameBuffer);
+	}
 	frameBuffer.showColorBuffer();
 }
 
@@ -76,10 +107,37 @@ void keyboard(unsigned char key, int x, int y) {
 	case 'P':
 	case 'p':	isMoving = !isMoving;
 				break;
-	case 'C':	// Do something here
-	case 'c':	break;
+	case 'C':
+	case 'c':	VertexOps::rasterPool = (VertexOps::rasterPool == nullptr) ? &rasterPool : nullptr;
+				std::cout << (VertexOps::rasterPool != nullptr ? "Multithreaded rasterization ON" : "Multithreaded rasterization OFF") << std::endl;
+				break;
+	case 'O':
+	case 'o':	overdrawCounter.reset();
+				occlusionStats.reset();
+				overdrawCounter.enabled = true;
+				break;
+	case 'D':
+	case 'd':	deferredShadingOn = !deferredShadingOn;
+				std::cout << (deferredShadingOn ? "Deferred shading ON" : "Deferred shading OFF") << std::endl;
+				break;
+	case 'H':
+	case 'h':	hierarchicalDepthTest = !hierarchicalDepthTest;
+				std::cout << (hierarchicalDepthTest ? "Hierarchical depth test ON" : "Hierarchical depth test OFF") << std::endl;
+				break;
+	case 'G':
+	case 'g':	VertexOps::cacheTransformedMeshes = !VertexOps::cacheTransformedMeshes;
+				std::cout << (VertexOps::cacheTransformedMeshes ? "Transformed mesh cache ON" : "Transformed mesh cache OFF") << std::endl;
+				break;
+	case 'V':
+	case 'v':	vectorizedCoverage = !vectorizedCoverage;
+				std::cout << "Triangle coverage: " << coveragePathName() << std::endl;
+				break;
 	case '?':	twoViewOn = !twoViewOn;
 				break;
+	case 'F':
+	case 'f':	edgeAntialiasingOn = !edgeAntialiasingOn;
+				std::cout << (edgeAntialiasingOn ? "Edge antialiasing ON" : "Edge antialiasing OFF") << std::endl;
+				break;
 	case ESCAPE:
 		glutLeaveMainLoop();
 		break;
@@ -128,6 +186,7 @@ int main(int argc, char *argv[]) {
 	glutMouseFunc(mouseUtility);
 
 	frameBuffer.setClearColor(lightGray);
+	VertexOps::rasterPool = &rasterPool;
 
 	glutMainLoop();
 
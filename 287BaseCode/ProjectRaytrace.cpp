@@ -8,6 +8,9 @@
 #include "Image.h"
 #include "Camera.h"
 #include "Rasterization.h"
+#include "RenderService.h"
+#include "QualityController.h"
+#include "EdgeAntialiaser.h"
 
 int currLight = 0;
 float angle = 0.5f;
@@ -28,29 +31,67 @@ SpotLightPtr spotLight = (SpotLightPtr)lights[1];
 
 FrameBuffer frameBuffer(WINDOW_WIDTH, WINDOW_HEIGHT);
 RayTracer rayTrace(lightGray);
+TracingOptions tracingOptions;		// the keys change these; each frame request takes a copy
+RenderService renderService(rayTrace);
+QualityController qualityController(0.1f);	// 10 frames per second
+bool adaptiveQuality = false;
+EdgeAntialiaser edgeAntialiaser;
+bool edgeAntialiasingOn = false;
 PerspectiveCamera pCamera(glm::vec3(0, 10, 10), ORIGIN3D, Y_AXIS, M_PI_2);
 OrthographicCamera oCamera(glm::vec3(0, 10, 10), ORIGIN3D, Y_AXIS, 45.0f);
+PerspectiveCamera secondCamera(glm::vec3(0, 10, 10), ORIGIN3D, Y_AXIS, M_PI_2);
 RaytracingCamera *cameras[] = { &pCamera, &oCamera };
 int currCamera = 0;
 bool twoCameras = false;
 IScene scene(cameras[currCamera], false);
 
+void requestRender() {
+	QualityLevel quality(1.0f, antiAliasing, numReflections);
+	if (adaptiveQuality) {
+		quality = qualityController.chooseQuality(antiAliasing, numReflections);
+	}
+	int width = std::max((int)(frameBuffer.getWindowWidth() * quality.resolutionScale), 1);
+	int height = std::max((int)(frameBuffer.getWindowHeight() * quality.resolutionScale), 1);
+	std::vector<RaytracingView> views;
+	if (twoViewOn) {
+		// second vantage point in the right half of the window
+		int leftWidth = width / 2;
+		cameras[currCamera]->calculateViewingParameters(leftWidth, height);
+		cameras[currCamera]->changeConfiguration(glm::vec3(-2, 8, -8), ORIGIN3D, Y_AXIS);
+		secondCamera.calculateViewingParameters(width - leftWidth, height);
+		secondCamera.changeConfiguration(glm::vec3(2, 8, -8), ORIGIN3D, Y_AXIS);
+		views.push_back(RaytracingView(cameras[currCamera], 0, 0, leftWidth, height));
+		views.push_back(RaytracingView(&secondCamera, leftWidth, 0, width - leftWidth, height));
+	} else {
+		cameras[currCamera]->calculateViewingParameters(width, height);
+		cameras[currCamera]->changeConfiguration(glm::vec3(-2, 8, -8), ORIGIN3D, Y_AXIS);
+		views.push_back(RaytracingView(cameras[currCamera], 0, 0, width, height));
+	}
+	renderService.requestFrame(scene, views, width, height, quality, tracingOptions);
+}
+
 void render() {
-	int frameStartTime = glutGet(GLUT_ELAPSED_TIME);
-	cameras[currCamera]->calculateViewingParameters(frameBuffer.getWindowWidth()/2, frameBuffer.getWindowHeight());
-	cameras[currCamera]->changeConfiguration(glm::vec3(-2, 8, -8), ORIGIN3D, Y_AXIS);
-	rayTrace.raytraceScene(frameBuffer, numReflections, scene, antiAliasing);
-
-	int frameEndTime = glutGet(GLUT_ELAPSED_TIME); // Get end time
-	float totalTimeSec = (frameEndTime - frameStartTime) / 1000.0f;
-	std::cout << "Render time: " << totalTimeSec << " sec." << std::endl;
+	// show whatever tiles the render threads have finished so far
+	if (renderService.publish(frameBuffer)) {
+		if (edgeAntialiasingOn) {
+			edgeAntialiaser.apply(frameBuffer);
+		}
+		const QualityLevel &quality = renderService.getFrameQuality();
+		if (adaptiveQuality) {
+			qualityController.recordFrameTime(renderService.lastFrameTime());
+		}
+		std::cout << "Render time: " << renderService.lastFrameTime() << " sec. (scale " <<
+			quality.resolutionScale << ", AA " << quality.aaValue << ", reflections " <<
+			quality.depth << ")" << std::endl;
+	}
+	frameBuffer.showColorBuffer();
 }
 
 void resize(int width, int height) {
 	frameBuffer.setFrameBufferSize(width, height);
-	cameras[currCamera]->calculateViewingParameters(width, height);
+	requestRender();
 	glutPostRedisplay();
-} 
+}
 
 ISphere *sphere = new ISphere(glm::vec3(-6.0f, 0.0f, -3.0f), 3.0f);
 IShape *plane = new IPlane(glm::vec3(0.0f, -2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
@@ -86,7 +127,8 @@ bool incX = true;
 void timer(int id) {
 	static int x = 0;
 
-	if (isAnimated) {
+	// wait for the previous frame, so that its time is measured and it is not cancelled
+	if (isAnimated && renderService.frameIsComplete()) {
 		if (x == 50)
 			incX = false;
 		if (x == 0)
@@ -97,6 +139,7 @@ void timer(int id) {
 			x -= 2;
 		sphere->center = glm::vec3(-6.0f, 0, x);
 		// modify something in your scene
+		requestRender();
 	}
 	glutTimerFunc(TIME_INTERVAL, timer, 0);
 	glutPostRedisplay();
@@ -168,15 +211,30 @@ void keyboard(unsigned char key, int x, int y) {
 	case 'P':
 	case 'p':	isAnimated = !isAnimated;
 				break;
+	case 'T':
+	case 't':	tracingOptions.dirtyRegionTracing = !tracingOptions.dirtyRegionTracing;
+				std::cout << (tracingOptions.dirtyRegionTracing ? "Dirty tiles only" : "Full frames") << std::endl;
+				break;
+	case 'G':
+	case 'g':	tracingOptions.relightingCache = !tracingOptions.relightingCache;
+				std::cout << (tracingOptions.relightingCache ? "Relighting cache ON" : "Relighting cache OFF") << std::endl;
+				break;
+	case 'I':
+	case 'i':	tracingOptions.tileObjectLists = !tracingOptions.tileObjectLists;
+				std::cout << (tracingOptions.tileObjectLists ? "Tile object lists ON" : "Tile object lists OFF") << std::endl;
+				break;
 	case 'C':
-	case 'c':	
+	case 'c':	tracingOptions.shadowCasterLists = !tracingOptions.shadowCasterLists;
+				std::cout << (tracingOptions.shadowCasterLists ? "Shadow caster lists ON" : "Shadow caster lists OFF") << std::endl;
 				break;
 	case 'U':
 	case 'u':	incrementClamp(pCamera.fov, isupper(key) ? 0.2f : -0.2f, glm::radians(10.0f), glm::radians(160.0f)); 
 				std::cout << pCamera.fov << std::endl;
 				break;
 	case 'M':
-	case 'm':	break;
+	case 'm':	edgeAntialiasingOn = !edgeAntialiasingOn;
+				std::cout << (edgeAntialiasingOn ? "Edge antialiasing ON" : "Edge antialiasing OFF") << std::endl;
+				break;
 	case '+':	antiAliasing = 3; 
 				std::cout << "Anti aliasing: " << antiAliasing << std::endl;
 				break;
@@ -193,6 +251,24 @@ void keyboard(unsigned char key, int x, int y) {
 				break;
 	case '?':	twoViewOn = !twoViewOn;
 				break;
+	case 'N':
+	case 'n':	tracingOptions.previewFactor = (tracingOptions.previewFactor >= 4) ? 1 : tracingOptions.previewFactor * 2;
+				std::cout << "Preview factor: " << tracingOptions.previewFactor << std::endl;
+				break;
+	case 'H':
+	case 'h':	adaptiveQuality = !adaptiveQuality;
+				std::cout << (adaptiveQuality ? "Adaptive quality ON" : "Adaptive quality OFF") << std::endl;
+				break;
+	case 'S':
+	case 's':	tracingOptions.checkerboardRendering = !tracingOptions.checkerboardRendering;
+				std::cout << (tracingOptions.checkerboardRendering ? "Checkerboard rendering ON" : "Checkerboard rendering OFF") << std::endl;
+				break;
+	case '*':	tracingOptions.lightHierarchy = !tracingOptions.lightHierarchy;
+				std::cout << (tracingOptions.lightHierarchy ? "Light hierarchy ON" : "Light hierarchy OFF") << std::endl;
+				break;
+	case '/':	tracingOptions.sampledLights = (tracingOptions.sampledLights == 0) ? 4 : (tracingOptions.sampledLights >= 16 ? 0 : tracingOptions.sampledLights * 2);
+				std::cout << "Sampled lights: " << tracingOptions.sampledLights << std::endl;
+				break;
 	case ESCAPE:
 		glutLeaveMainLoop();
 		break;
@@ -200,6 +276,7 @@ void keyboard(unsigned char key, int x, int y) {
 		std::cout << (int)key << "unmapped key pressed." << std::endl;
 	}
 
+	requestRender();
 	glutPostRedisplay();
 }
 
@@ -213,6 +290,7 @@ void special(int key, int x, int y) {
 		default:
 			std::cout << key << " special key pressed." << std::endl;
 	}
+	requestRender();
 	glutPostRedisplay();
 }
 
@@ -239,6 +317,9 @@ int main(int argc, char *argv[]) {
 	glutMouseFunc(mouse);
 	glutTimerFunc(TIME_INTERVAL, timer, 0);
 	buildScene();
+	// ray traced frames carry the t value of each pixel, so silhouettes are found
+	// even where the colors on both sides are alike
+	edgeAntialiaser.useDepth = true;
 
 	glutMainLoop();
 
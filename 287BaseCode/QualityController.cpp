@@ -0,0 +1,164 @@
+#include <algorithm>
+#include "QualityController.h"
+
+// the quality ladder, from best to cheapest. Each rung caps the user's settings.
+static const QualityLevel LADDER[] = { QualityLevel(1.0f, 3, 2), QualityLevel(1.0f, 1, 2),
+										QualityLevel(1.0f, 1, 1), QualityLevel(1.0f, 1, 0),
+										QualityLevel(0.75f, 1, 0), QualityLevel(0.5f, 1, 0),
+										QualityLevel(0.25f, 1, 0) };
+static const int NUM_LEVELS = sizeof(LADDER) / sizeof(LADDER[0]);
+
+// number of frames averaged before the quality may change.
+static const unsigned int FRAMES_PER_DECISION = 4;
+
+// the quality drops when frames average more than this fraction of the target.
+// It rises when the better rung's estimated time is under the target, so the
+// rung reached is not immediately too slow.
+static const float SLOW_FRACTION = 1.1f;
+
+/**
+ * @fn	QualityLevel::QualityLevel(float scale, int aa, int depth)
+ * @brief	Constructs a quality level.
+ * @param	scale	Fraction of the window size that is traced.
+ * @param	aa   	1 for no antialiasing, 3 for 9 samples per pixel.
+ * @param	depth	The recursion depth.
+ */
+
+QualityLevel::QualityLevel(float scale, int aa, int depth)
+	: resolutionScale(scale), aaValue(aa), depth(depth) {
+}
+
+/**
+ * @fn	bool QualityLevel::operator == (const QualityLevel &other) const
+ * @brief	Equality operator.
+ * @param	other	The other level.
+ * @return	True iff the two levels render identically.
+ */
+
+bool QualityLevel::operator == (const QualityLevel &other) const {
+	return resolutionScale == other.resolutionScale && aaValue == other.aaValue && depth == other.depth;
+}
+
+/**
+ * @fn	float QualityLevel::relativeCost() const
+ * @brief	Estimates the cost of a frame at this level, relative to a full size frame
+ * 			without antialiasing or reflections. Each level of reflection is counted as
+ * 			one more ray per sample, so the estimate errs high.
+ * @return	The estimated relative cost.
+ */
+
+float QualityLevel::relativeCost() const {
+	return resolutionScale * resolutionScale * aaValue * aaValue * (1 + depth);
+}
+
+/**
+ * @fn	QualityController::QualityController(float targetSeconds)
+ * @brief	Constructs a controller that starts at full quality.
+ * @param	targetSeconds	The frame time to aim for, in seconds.
+ */
+
+QualityController::QualityController(float targetSeconds)
+	: targetFrameTime(targetSeconds), level(0), requestedAA(1), requestedDepth(0) {
+}
+
+/**
+ * @fn	int QualityController::numLevels()
+ * @brief	Gets the number of rungs on the quality ladder.
+ * @return	The number of levels.
+ */
+
+int QualityController::numLevels() {
+	return NUM_LEVELS;
+}
+
+/**
+ * @fn	void QualityController::recordFrameTime(float seconds)
+ * @brief	Records how long a frame took, and moves up or down the ladder once
+ * 			enough frames have been seen at the current level.
+ * @param	seconds	The time the frame took.
+ */
+
+void QualityController::recordFrameTime(float seconds) {
+	recentTimes.push_back(seconds);
+	if (recentTimes.size() < FRAMES_PER_DECISION) {
+		return;
+	}
+	float average = 0.0f;
+	for (unsigned int i = 0; i < recentTimes.size(); i++) {
+		average += recentTimes[i];
+	}
+	average /= recentTimes.size();
+	recentTimes.erase(recentTimes.begin());
+
+	int newLevel = level;
+	if (average > targetFrameTime * SLOW_FRACTION) {
+		newLevel = nextDistinctLevel(level, 1);
+	} else {
+		int better = nextDistinctLevel(level, -1);
+		float costRatio = levelQuality(better).relativeCost() / levelQuality(level).relativeCost();
+		if (average * costRatio < targetFrameTime) {
+			newLevel = better;
+		}
+	}
+	if (newLevel != level) {
+		level = newLevel;
+		recentTimes.clear();
+	}
+}
+
+/**
+ * @fn	QualityLevel QualityController::chooseQuality(int aaValue, int depth)
+ * @brief	Chooses the quality of the next frame.
+ * @param	aaValue	The antialiasing the user asked for.
+ * @param	depth  	The recursion depth the user asked for.
+ * @return	The quality to render with. It never exceeds what the user asked for.
+ */
+
+QualityLevel QualityController::chooseQuality(int aaValue, int depth) {
+	if (aaValue != requestedAA || depth != requestedDepth) {
+		// the user's settings changed; frame times seen so far no longer apply
+		requestedAA = aaValue;
+		requestedDepth = depth;
+		recentTimes.clear();
+	}
+	return levelQuality(level);
+}
+
+/**
+ * @fn	QualityLevel QualityController::levelQuality(int lvl) const
+ * @brief	Gets the quality of a rung, capped by the user's settings.
+ * @param	lvl	The rung.
+ * @return	The quality.
+ */
+
+QualityLevel QualityController::levelQuality(int lvl) const {
+	const QualityLevel &rung = LADDER[lvl];
+	return QualityLevel(rung.resolutionScale, std::min(rung.aaValue, requestedAA),
+						std::min(rung.depth, requestedDepth));
+}
+
+/**
+ * @fn	int QualityController::nextDistinctLevel(int lvl, int step) const
+ * @brief	Finds the nearest rung in a direction that renders differently from a
+ * 			given one, skipping rungs the user's settings make identical.
+ * @param	lvl 	The starting rung.
+ * @param	step	1 to go down the ladder, -1 to go up.
+ * @return	The rung, or lvl if there is none.
+ */
+
+int QualityController::nextDistinctLevel(int lvl, int step) const {
+	QualityLevel current = levelQuality(lvl);
+	int i = lvl + step;
+	while (i >= 0 && i < NUM_LEVELS && levelQuality(i) == current) {
+		i += step;
+	}
+	if (i < 0 || i >= NUM_LEVELS) {
+		return lvl;
+	}
+	// going up, settle on the best of the rungs that render the same
+	QualityLevel found = levelQuality(i);
+	while (step < 0 && i > 0 && levelQuality(i - 1) == found) {
+		i--;
+	}
+	return i;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+
+/**
+ * @struct	QualityLevel
+ * @brief	The settings a frame is rendered with.
+ */
+
+struct QualityLevel {
+	float resolutionScale;	//!< fraction of the window size that is traced (1 for full size)
+	int aaValue;			//!< 1 for no antialiasing, 3 for 9 samples per pixel
+	int depth;				//!< recursion depth
+	QualityLevel(float scale = 1.0f, int aa = 1, int depth = 0);
+	bool operator == (const QualityLevel &other) const;
+	float relativeCost() const;
+};
+
+/**
+ * @struct	QualityController
+ * @brief	Picks the quality of each frame so that frames take about a target time.
+ * 			The quality steps down a ladder (antialiasing first, then reflections, then
+ * 			resolution) when recent frames are too slow, and back up only when the better
+ * 			rung, at its estimated cost, would still meet the target. A step is only taken
+ * 			after several frames agree, so the quality does not oscillate.
+ */
+
+struct QualityController {
+	float targetFrameTime;		//!< the frame time to aim for, in seconds
+	QualityController(float targetSeconds);
+	void recordFrameTime(float seconds);
+	QualityLevel chooseQuality(int aaValue, int depth);
+	int getLevel() const { return level; }
+	static int numLevels();
+protected:
+	int level;							//!< current rung of the ladder (0 is full quality)
+	int requestedAA;					//!< antialiasing the user asked for
+	int requestedDepth;					//!< recursion depth the user asked for
+	std::vector<float> recentTimes;		//!< frame times measured at the current level
+	QualityLevel levelQuality(int lvl) const;
+	int nextDistinctLevel(int lvl, int step) const;
+};
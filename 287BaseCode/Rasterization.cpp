@@ -1,6 +1,30 @@
 #include <cmath>
+#include <atomic>
 #include "Rasterization.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled whether or not the compiler targets AVX2, and only run
+// on CPUs that support it
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define RASTER_AVX2
+#define RASTER_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RASTER_AVX2
+#define RASTER_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+bool vectorizedCoverage = true;
+bool hierarchicalDepthTest = true;
+OverdrawCounter overdrawCounter;
+OcclusionStats occlusionStats;
+
 /**
 * @fn	template <class T> T barycentricWeighting(float w1, float w2, float w3, const T &i1, const T &i2, const T &i3)
 * @brief	Computes the Barycentric weighting of three values.
@@ -223,6 +247,30 @@ static float cheapNonPerspectiveCorrectInterpolationForLines(const glm::vec2 &st
 	return glm::length(online - start) / glm::length(end - start);
 }
 
+/**
+ * @fn	static void setLineMaterial(Fragment &fragment, Material &blended, const VertexData &v0, const VertexData &v1, float weight)
+ * @brief	Gives a fragment of a line its material. Endpoints with the same material
+ * 			pass it on by index; otherwise their materials are averaged.
+ * @param [in,out]	fragment	The fragment.
+ * @param [in,out]	blended 	Holds the averaged material, which the fragment points to.
+ * @param 		  	v0			The first endpoint.
+ * @param 		  	v1			The second endpoint.
+ * @param 		  	weight  	Weight of the second endpoint.
+ */
+
+static void setLineMaterial(Fragment &fragment, Material &blended,
+							const VertexData &v0, const VertexData &v1, float weight) {
+	if (v0.material == v1.material) {
+		fragment.material = &MaterialTable::get(v0.material);
+		fragment.materialIndex = v0.material;
+	} else {
+		blended = weightedAverage(1.0f - weight, MaterialTable::get(v0.material),
+									weight, MaterialTable::get(v1.material));
+		fragment.material = &blended;
+		fragment.materialIndex = -1;
+	}
+}
+
 /**
  * @fn	void drawVerticalLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights, VertexData v0, VertexData v1, const glm::mat4 &viewingMatrix)
  * @brief	Draw vertical line
@@ -240,6 +288,7 @@ static void drawVerticalLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 	if (v1.position.y < v0.position.y) {
 		std::swap(v0, v1);
 	}
+	Material blended;
 
 	float zDifference = v1.position.z - v0.position.z;
 
@@ -251,7 +300,7 @@ static void drawVerticalLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 
 		// Interpolate vertex attributes using alpha, beta, and gamma weights
 		float oneMinusW = 1.0f - weight;
-		fragment.material = weightedAverage(oneMinusW, v0.material, weight, v1.material);
+		setLineMaterial(fragment, blended, v0, v1, weight);
 		float z = weightedAverage(oneMinusW, v0.position.z, weight, v1.position.z);
 		fragment.worldNormal = weightedAverage(oneMinusW, v0.normal, weight, v1.normal);
 		fragment.worldPosition = weightedAverage(oneMinusW, v0.worldPosition, weight, v1.worldPosition);
@@ -278,6 +327,7 @@ static void drawHorizontalLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos
 	if (v1.position.x < v0.position.x) {
 		std::swap(v0, v1);
 	}
+	Material blended;
 
 	for (float x = v0.position.x; x < v1.position.x; x++) {
 		// Interpolate vertex attributes
@@ -286,7 +336,7 @@ static void drawHorizontalLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos
 		Fragment fragment;
 
 		// Interpolate vertex attributes using alpha, beta, and gamma weights
-		fragment.material = weightedAverage(1.0f - weight, v0.material, weight, v1.material);
+		setLineMaterial(fragment, blended, v0, v1, weight);
 		float z = weightedAverage(1 - weight, v0.position.z, weight, v1.position.z);
 		fragment.worldNormal = weightedAverage(1.0f - weight, v0.normal, weight, v1.normal);
 		fragment.worldPosition = weightedAverage(1.0f - weight, v0.worldPosition, weight, v1.worldPosition);
@@ -313,6 +363,7 @@ static void midPointLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 	if (v1.position.x < v0.position.x) {
 		std::swap(v0, v1);
 	}
+	Material blended;
 
 	// Calculate slope of the line
 	float m = (v1.position.y - v0.position.y) / (v1.position.x - v0.position.x);
@@ -328,7 +379,7 @@ static void midPointLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 			Fragment fragment;
 
 			// Interpolate vertex attributes using alpha, beta, and gamma weights
-			fragment.material = weightedAverage(1.0f - weight, v0.material, weight, v1.material);
+			setLineMaterial(fragment, blended, v0, v1, weight);
 			float z = weightedAverage(1 - weight, v0.position.z, weight, v1.position.z);
 			fragment.worldNormal = weightedAverage(1.0f - weight, v0.normal, weight, v1.normal);
 			fragment.worldPosition = weightedAverage(1.0f - weight, v0.worldPosition, weight, v1.worldPosition);
@@ -357,7 +408,7 @@ static void midPointLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 			Fragment fragment;
 
 			// Interpolate vertex attributes using alpha, beta, and gamma weights
-			fragment.material = weightedAverage(1.0f - weight, v0.material, weight, v1.material);
+			setLineMaterial(fragment, blended, v0, v1, weight);
 			float z = weightedAverage(1 - weight, v0.position.z, weight, v1.position.z);
 			fragment.worldNormal = weightedAverage(1.0f - weight, v0.normal, weight, v1.normal);
 			fragment.worldPosition = weightedAverage(1.0f - weight, v0.worldPosition, weight, v1.worldPosition);
@@ -386,7 +437,7 @@ static void midPointLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 			Fragment fragment;
 
 			// Interpolate vertex attributes using alpha, beta, and gamma weights
-			fragment.material = weightedAverage(1.0f - weight, v0.material, weight, v1.material);
+			setLineMaterial(fragment, blended, v0, v1, weight);
 			float z = weightedAverage(1 - weight, v0.position.z, weight, v1.position.z);
 			fragment.worldNormal = weightedAverage(1.0f - weight, v0.normal, weight, v1.normal);
 			fragment.worldPosition = weightedAverage(1.0f - weight, v0.worldPosition, weight, v1.worldPosition);
@@ -416,7 +467,7 @@ static void midPointLine(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 			Fragment fragment;
 
 			// Interpolate vertex attributes using alpha, beta, and gamma weights
-			fragment.material = weightedAverage(1.0f - weight, v0.material, weight, v1.material);
+			setLineMaterial(fragment, blended, v0, v1, weight);
 			float z = weightedAverage(1 - weight, v0.position.z, weight, v1.position.z);
 			fragment.worldNormal = weightedAverage(1.0f - weight, v0.normal, weight, v1.normal);
 			fragment.worldPosition = weightedAverage(1.0f - weight, v0.worldPosition, weight, v1.worldPosition);
@@ -525,58 +576,477 @@ void drawManyWireFrameTriangles(FrameBuffer &frameBuffer,
 	}
 }
 
+// window coordinates are snapped to 1/16 pixel, i.e., 28.4 fixed point.
+static const int SUBPIXEL_BITS = 4;
+static const float SUBPIXELS_PER_PIXEL = (float)(1 << SUBPIXEL_BITS);
+
+// vertices farther than this many pixels from the window's origin are not drawn,
+// which keeps the edge functions within 64 bits.
+static const float FIXED_POINT_LIMIT = (float)(1 << 20);
+
 /**
- * @fn	static inline float f01(const VertexData &v0, const VertexData &v1, const VertexData &v2, float x, float y)
- * @brief	Computes f01. Implicit equation for the line between v0 and v1.
- * @see		*** page in textbook.
+ * @fn	static bool snapToSubpixels(const glm::vec4 &position, glm::ivec2 &snapped)
+ * @brief	Rounds a window position to the nearest subpixel.
+ * @param 		  	position	The window position.
+ * @param [out]		snapped 	Receives the position, in 28.4 fixed point.
+ * @return	False if the position is too far from the window to be drawn.
+ */
+
+static bool snapToSubpixels(const glm::vec4 &position, glm::ivec2 &snapped) {
+	if (!(std::abs(position.x) < FIXED_POINT_LIMIT && std::abs(position.y) < FIXED_POINT_LIMIT)) {
+		return false;
+	}
+	snapped.x = (int)std::floor(position.x * SUBPIXELS_PER_PIXEL + 0.5f);
+	snapped.y = (int)std::floor(position.y * SUBPIXELS_PER_PIXEL + 0.5f);
+	return true;
+}
+
+/**
+ * @struct	EdgeFunction
+ * @brief	The implicit equation A*x + B*y + C for the line through two vertices,
+ * 			in fixed point. A and B are in 28.4 and C in 24.8, so the function's
+ * 			value at a pixel is exact.
+ */
+
+struct EdgeFunction {
+	int A, B;		//!< coefficients, in 28.4
+	long long C;	//!< constant term, in 24.8
+	int step;		//!< change in the value per pixel in x
+	int bias;		//!< 0 if pixels exactly on the edge are drawn, otherwise -1
+	EdgeFunction() {}
+	EdgeFunction(const glm::ivec2 &p, const glm::ivec2 &q)
+		: A(p.y - q.y), B(q.x - p.x), C((long long)p.x * q.y - (long long)q.x * p.y),
+		step((p.y - q.y) << SUBPIXEL_BITS), bias(0) {
+	}
+	long long operator () (int x, int y) const {
+		return (long long)A * (x << SUBPIXEL_BITS) + (long long)B * (y << SUBPIXEL_BITS) + C;
+	}
+	void negate() {
+		A = -A;
+		B = -B;
+		C = -C;
+		step = -step;
+	}
+	// with the function positive inside, the edge is a left edge or a horizontal top edge
+	bool isTopLeft() const {
+		return A > 0 || (A == 0 && B < 0);
+	}
+};
+
+/**
+ * @struct	TriangleSetup
+ * @brief	What drawing a filled triangle needs, computed once per triangle: the
+ * 			pixels it may cover, its edge functions, and the change in the
+ * 			barycentric weights and interpolated attributes per pixel in x.
+ * 			The edge functions are oriented to be positive inside the triangle, and
+ * 			pixels exactly on an edge are drawn only for top and left edges. A
+ * 			pixel on an edge shared by two triangles is thus drawn by exactly one
+ * 			of them.
+ */
+
+struct TriangleSetup {
+	EdgeFunction edges[3];			//!< edges opposite v0, v1 and v2
+	int xMin, xMax, yMin, yMax;		//!< the pixels the triangle may cover
+	float zMin;						//!< window z of the nearest vertex
+	bool oneMaterial;				//!< true if the vertices share a material, so it needs no interpolation
+	const Material *materials[3];	//!< the vertices' materials
+	float invArea;					//!< reciprocal of the edge functions at their opposite vertices
+	float dAlpha, dBeta, dGamma;	//!< change in the barycentric weights per pixel in x
+	float dz;						//!< change in window z per pixel in x
+	glm::vec3 dNormal;				//!< change in the normal per pixel in x
+	glm::vec3 dWorldPosition;		//!< change in the world position per pixel in x
+	bool setup(const VertexData &v0, const VertexData &v1, const VertexData &v2);
+	bool mayCover(int left, int right, int bottom, int top) const;
+};
+
+/**
+ * @fn	bool TriangleSetup::setup(const VertexData &v0, const VertexData &v1, const VertexData &v2)
+ * @brief	Sets up a triangle for drawing.
  * @param	v0	v0.
  * @param	v1	v1.
  * @param	v2	v2.
- * @param	x 	x coordinate.
- * @param	y 	y coordinate.
- * @return	f01.
+ * @return	False if the triangle has no area once snapped to subpixels, and so
+ * 			covers no pixels, or if it is too far from the window.
  */
 
-static inline float f01(const VertexData &v0, const VertexData &v1, const VertexData &v2, float x, float y) {
-	return (v0.position.y - v1.position.y) * x + (v1.position.x - v0.position.x) * y +
-		(v0.position.x * v1.position.y) - (v1.position.x * v0.position.y);
+bool TriangleSetup::setup(const VertexData &v0, const VertexData &v1, const VertexData &v2) {
+	glm::ivec2 p0, p1, p2;
+	if (!snapToSubpixels(v0.position, p0) || !snapToSubpixels(v1.position, p1) ||
+		!snapToSubpixels(v2.position, p2)) {
+		return false;
+	}
+	edges[0] = EdgeFunction(p1, p2);
+	edges[1] = EdgeFunction(p2, p0);
+	edges[2] = EdgeFunction(p0, p1);
+	// twice the signed area; each edge function has this value at its opposite vertex
+	long long area = edges[0].C + edges[1].C + edges[2].C;
+	if (area == 0) {
+		return false;
+	}
+	if (area < 0) {
+		area = -area;
+		for (int i = 0; i < 3; i++) {
+			edges[i].negate();
+		}
+	}
+	for (int i = 0; i < 3; i++) {
+		edges[i].bias = edges[i].isTopLeft() ? 0 : -1;
+	}
+	// shifting rounds down, even for negative coordinates
+	xMin = std::min(std::min(p0.x, p1.x), p2.x) >> SUBPIXEL_BITS;
+	yMin = std::min(std::min(p0.y, p1.y), p2.y) >> SUBPIXEL_BITS;
+	xMax = -(-std::max(std::max(p0.x, p1.x), p2.x) >> SUBPIXEL_BITS);
+	yMax = -(-std::max(std::max(p0.y, p1.y), p2.y) >> SUBPIXEL_BITS);
+	zMin = min(v0.position.z, v1.position.z, v2.position.z);
+	oneMaterial = v0.material == v1.material && v1.material == v2.material;
+	materials[0] = &MaterialTable::get(v0.material);
+	materials[1] = &MaterialTable::get(v1.material);
+	materials[2] = &MaterialTable::get(v2.material);
+
+	invArea = 1.0f / area;
+	dAlpha = edges[0].step * invArea;
+	dBeta = edges[1].step * invArea;
+	dGamma = edges[2].step * invArea;
+	dz = barycentricWeighting(dAlpha, dBeta, dGamma, v0.position.z, v1.position.z, v2.position.z);
+	dNormal = barycentricWeighting(dAlpha, dBeta, dGamma, v0.normal, v1.normal, v2.normal);
+	dWorldPosition = barycentricWeighting(dAlpha, dBeta, dGamma,
+											v0.worldPosition, v1.worldPosition, v2.worldPosition);
+	return true;
+}
+
+/**
+ * @fn	bool TriangleSetup::mayCover(int left, int right, int bottom, int top) const
+ * @brief	Determines if the triangle may cover any pixel of a rectangle, by
+ * 			checking whether the rectangle lies wholly outside one of its edges.
+ * @param	left  	Left column of the rectangle.
+ * @param	right 	Right column of the rectangle (inclusive).
+ * @param	bottom	Bottom row of the rectangle.
+ * @param	top   	Top row of the rectangle (inclusive).
+ * @return	False if no pixel of the rectangle is covered.
+ */
 
+bool TriangleSetup::mayCover(int left, int right, int bottom, int top) const {
+	for (int k = 0; k < 3; k++) {
+		// the corner where the edge function is largest
+		int x = edges[k].A > 0 ? right : left;
+		int y = edges[k].B > 0 ? top : bottom;
+		if (edges[k](x, y) + edges[k].bias < 0) {
+			return false;
+		}
+	}
+	return true;
 }
 
+// number of pixels whose coverage and depth are evaluated together: a row of a depth tile.
+static const int RASTER_LANES = DEPTH_TILE_SIZE;
+
 /**
- * @fn	static inline float f12(const VertexData &v0, const VertexData &v1, const VertexData &v2, float x, float y)
- * @brief	Computes f12. Implicit equation for the line between v1 and v2.
- * @see		*** page in textbook.
- * @param	v0	v0.
- * @param	v1	v1.
- * @param	v2	v2.
- * @param	x 	x coordinate.
- * @param	y 	y coordinate.
- * @return	f12.
+ * @enum	CoveragePath
+ * @brief	The instructions that evaluate the coverage of a run of pixels.
  */
 
-static inline float f12(const VertexData &v0, const VertexData &v1, const VertexData &v2, float x, float y) {
-	return (v1.position.y - v2.position.y) * x + (v2.position.x - v1.position.x) * y +
-		(v1.position.x * v2.position.y) - (v2.position.x * v1.position.y);
+enum CoveragePath { COVERAGE_SCALAR, COVERAGE_SSE2, COVERAGE_AVX2 };
+
+/**
+ * @fn	static CoveragePath detectCoveragePath()
+ * @brief	Chooses the widest coverage path that this build and CPU support.
+ * @return	The coverage path.
+ */
 
+static CoveragePath detectCoveragePath() {
+#if defined(RASTER_AVX2) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7) {
+		__cpuid(info, 1);
+		// the CPU must have AVX and the OS must save the YMM registers
+		bool osSavesYMM = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+							(_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		if (osSavesYMM && (info[1] & (1 << 5)) != 0) {
+			return COVERAGE_AVX2;
+		}
+	}
+#elif defined(RASTER_AVX2)
+	if (__builtin_cpu_supports("avx2")) {
+		return COVERAGE_AVX2;
+	}
+#endif
+#ifdef RASTER_SSE2
+	return COVERAGE_SSE2;
+#else
+	return COVERAGE_SCALAR;
+#endif
 }
 
+static const CoveragePath coveragePath = detectCoveragePath();
+
 /**
- * @fn	static inline float f20(const VertexData &v0, const VertexData &v1, const VertexData &v2, float x, float y)
- * @brief	Computes f20. Implicit equation for the line between v2 and v0.
- * @see		*** page in textbook.
- * @param	v0	v0.
- * @param	v1	v1.
- * @param	v2	v2.
- * @param	x 	x coordinate.
- * @param	y 	y coordinate.
- * @return	f02.
+ * @fn	const char *coveragePathName()
+ * @brief	Names the instructions that evaluate triangle coverage.
+ * @return	"AVX2", "SSE2" or "scalar".
  */
 
-static inline float f20(const VertexData &v0, const VertexData &v1, const VertexData &v2, float x, float y) {
-	return (v2.position.y - v0.position.y) * x + (v0.position.x - v2.position.x) * y +
-		(v2.position.x * v0.position.y) - (v0.position.x * v2.position.y);
+const char *coveragePathName() {
+	CoveragePath path = vectorizedCoverage ? coveragePath : COVERAGE_SCALAR;
+	return path == COVERAGE_AVX2 ? "AVX2" : (path == COVERAGE_SSE2 ? "SSE2" : "scalar");
+}
+
+/**
+ * @fn	static int coverPixelsScalar(const TriangleSetup &tri, const long long *edges, float z, const float *depthRow, int count)
+ * @brief	Evaluates the coverage and depth test of a run of pixels in a row, one
+ * 			pixel at a time.
+ * @param	tri	   	The triangle's setup.
+ * @param	edges  	The biased edge functions at the first pixel.
+ * @param	z	   	Window z at the first pixel.
+ * @param	depthRow	Depths of the pixels, or nullptr to skip the depth test.
+ * @param	count  	Number of pixels, at most RASTER_LANES.
+ * @return	Bit i is set iff pixel i is covered, and bit i + RASTER_LANES iff it
+ * 			also passes the depth test.
+ */
 
+static int coverPixelsScalar(const TriangleSetup &tri, const long long *edges, float z,
+								const float *depthRow, int count) {
+	int mask = 0;
+	for (int i = 0; i < count; i++) {
+		if (edges[0] + (long long)i * tri.edges[0].step >= 0 &&
+			edges[1] + (long long)i * tri.edges[1].step >= 0 &&
+			edges[2] + (long long)i * tri.edges[2].step >= 0) {
+			mask |= 1 << i;
+			if (depthRow == nullptr || z + i * tri.dz < depthRow[i]) {
+				mask |= 1 << (i + RASTER_LANES);
+			}
+		}
+	}
+	return mask;
+}
+
+#ifdef RASTER_SSE2
+/**
+ * @fn	static int coverPixelsSSE2(const TriangleSetup &tri, const int *edges, float z, const float *depthRow)
+ * @brief	Evaluates the coverage and depth test of RASTER_LANES pixels in a row,
+ * 			four at a time.
+ * @param	tri	   	The triangle's setup.
+ * @param	edges  	The biased edge functions at the first pixel.
+ * @param	z	   	Window z at the first pixel.
+ * @param	depthRow	Depths of the pixels, or nullptr to skip the depth test.
+ * @return	Bit i is set iff pixel i is covered, and bit i + RASTER_LANES iff it
+ * 			also passes the depth test.
+ */
+
+static int coverPixelsSSE2(const TriangleSetup &tri, const int *edges, float z, const float *depthRow) {
+	int covered = 0, passed = 0;
+	for (int half = 0; half < RASTER_LANES; half += 4) {
+		__m128i inside = _mm_setzero_si128();
+		for (int k = 0; k < 3; k++) {
+			// the caller checked that these values fit in 32 bits
+			int s = tri.edges[k].step;
+			__m128i e = _mm_add_epi32(_mm_set1_epi32(edges[k] + half * s), _mm_setr_epi32(0, s, 2 * s, 3 * s));
+			inside = _mm_or_si128(inside, e);
+		}
+		// a pixel is covered when no edge function is negative
+		int mask = ~_mm_movemask_ps(_mm_castsi128_ps(inside)) & 0xF;
+		covered |= mask << half;
+		if (depthRow != nullptr) {
+			__m128 lane = _mm_setr_ps((float)half, half + 1.0f, half + 2.0f, half + 3.0f);
+			__m128 zs = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(lane, _mm_set1_ps(tri.dz)));
+			mask &= _mm_movemask_ps(_mm_cmplt_ps(zs, _mm_loadu_ps(depthRow + half)));
+		}
+		passed |= mask << half;
+	}
+	return covered | (passed << RASTER_LANES);
+}
+#endif
+
+#ifdef RASTER_AVX2
+/**
+ * @fn	static int coverPixelsAVX2(const TriangleSetup &tri, const int *edges, float z, const float *depthRow)
+ * @brief	Evaluates the coverage and depth test of RASTER_LANES pixels in a row,
+ * 			all at once.
+ * @param	tri	   	The triangle's setup.
+ * @param	edges  	The biased edge functions at the first pixel.
+ * @param	z	   	Window z at the first pixel.
+ * @param	depthRow	Depths of the pixels, or nullptr to skip the depth test.
+ * @return	Bit i is set iff pixel i is covered, and bit i + RASTER_LANES iff it
+ * 			also passes the depth test.
+ */
+
+RASTER_AVX2_TARGET
+static int coverPixelsAVX2(const TriangleSetup &tri, const int *edges, float z, const float *depthRow) {
+	__m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i inside = _mm256_setzero_si256();
+	for (int k = 0; k < 3; k++) {
+		__m256i e = _mm256_add_epi32(_mm256_set1_epi32(edges[k]),
+									_mm256_mullo_epi32(lane, _mm256_set1_epi32(tri.edges[k].step)));
+		inside = _mm256_or_si256(inside, e);
+	}
+	// a pixel is covered when no edge function is negative
+	int covered = ~_mm256_movemask_ps(_mm256_castsi256_ps(inside)) & 0xFF;
+	int passed = covered;
+	if (depthRow != nullptr) {
+		__m256 zs = _mm256_add_ps(_mm256_set1_ps(z), _mm256_mul_ps(_mm256_cvtepi32_ps(lane), _mm256_set1_ps(tri.dz)));
+		passed &= _mm256_movemask_ps(_mm256_cmp_ps(zs, _mm256_loadu_ps(depthRow), _CMP_LT_OQ));
+	}
+	return covered | (passed << RASTER_LANES);
+}
+#endif
+
+/**
+ * @fn	static int coverPixels(const TriangleSetup &tri, const long long *edges, float z, const float *depthRow, int count)
+ * @brief	Evaluates the coverage and depth test of a run of pixels in a row, with
+ * 			the widest instructions available. The vector paths step the edge
+ * 			functions in 32 bits, so they are only used when the run's values fit.
+ * @param	tri	   	The triangle's setup.
+ * @param	edges  	The biased edge functions at the first pixel.
+ * @param	z	   	Window z at the first pixel.
+ * @param	depthRow	Depths of the pixels, or nullptr to skip the depth test.
+ * @param	count  	Number of pixels, at most RASTER_LANES.
+ * @return	Bit i is set iff pixel i is covered, and bit i + RASTER_LANES iff it
+ * 			also passes the depth test.
+ */
+
+static int coverPixels(const TriangleSetup &tri, const long long *edges, float z,
+						const float *depthRow, int count) {
+	if (count == RASTER_LANES && vectorizedCoverage && coveragePath != COVERAGE_SCALAR) {
+		int narrow[3];
+		for (int k = 0; k < 3; k++) {
+			long long last = edges[k] + (long long)(RASTER_LANES - 1) * tri.edges[k].step;
+			if (std::min(edges[k], last) < INT_MIN || std::max(edges[k], last) > INT_MAX) {
+				return coverPixelsScalar(tri, edges, z, depthRow, count);
+			}
+			narrow[k] = (int)edges[k];
+		}
+#ifdef RASTER_AVX2
+		if (coveragePath == COVERAGE_AVX2) {
+			return coverPixelsAVX2(tri, narrow, z, depthRow);
+		}
+#endif
+#ifdef RASTER_SSE2
+		return coverPixelsSSE2(tri, narrow, z, depthRow);
+#endif
+	}
+	return coverPixelsScalar(tri, edges, z, depthRow, count);
+}
+
+/**
+ * @fn	static void drawFilledTriangleInRect(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights, const VertexData &v0, const VertexData &v1, const VertexData &v2, const TriangleSetup &tri, const glm::mat4 &viewingMatrix, const BoundingBoxi &rect)
+ * @brief	Draw the part of a filled triangle that lies in a rectangle of pixels.
+ * @param [in,out]	frameBuffer  	Framebuffer.
+ * @param 		  	eyePos		 	Eye position.
+ * @param 		  	lights		 	Vector of lights in scene.
+ * @param 		  	v0			 	v0.
+ * @param 		  	v1			 	v1.
+ * @param 		  	v2			 	v2.
+ * @param 		  	tri			 	The triangle's setup.
+ * @param 		  	viewingMatrix	Viewing matrix.
+ * @param 		  	rect		 	The pixels that may be drawn (inclusive), within the window.
+ */
+
+static void drawFilledTriangleInRect(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights,
+									const VertexData &v0, const VertexData &v1, const VertexData &v2,
+									const TriangleSetup &tri, const glm::mat4 &viewingMatrix, const BoundingBoxi &rect) {
+	const int W = frameBuffer.getWindowWidth();
+	int xMin = std::max(tri.xMin, rect.lx);
+	int xMax = std::min(tri.xMax, rect.rx);
+	int yMin = std::max(tri.yMin, rect.ly);
+	int yMax = std::min(tri.yMax, rect.ry);
+	if (xMin > xMax || yMin > yMax) {
+		return;
+	}
+	const float *depthBuffer = FragmentOps::performDepthTest ? frameBuffer.getDepthBuffer() : nullptr;
+	bool cullHiddenTiles = depthBuffer != nullptr && hierarchicalDepthTest;
+	unsigned short *coverage = (overdrawCounter.enabled && (int)overdrawCounter.counts.size() == W * frameBuffer.getWindowHeight())
+								? &overdrawCounter.counts[0] : nullptr;
+	int tilesTested = 0, tilesHidden = 0;
+	Material blended;
+
+	// visit the triangle's pixels a depth tile at a time, so that tiles where it
+	// is behind everything drawn so far are rejected whole
+	for (int ty = yMin / DEPTH_TILE_SIZE; ty <= yMax / DEPTH_TILE_SIZE; ty++) {
+		int bottom = std::max(ty * DEPTH_TILE_SIZE, yMin);
+		int top = std::min(ty * DEPTH_TILE_SIZE + DEPTH_TILE_SIZE - 1, yMax);
+		// a bit per row of the band, set once the row has entered the triangle, and
+		// once it has left it; the triangle is convex, so a row cannot re-enter it
+		int rowsEntered = 0, rowsLeft = 0;
+		int allRows = (1 << (top - bottom + 1)) - 1;
+		for (int tx = xMin / DEPTH_TILE_SIZE; tx <= xMax / DEPTH_TILE_SIZE && rowsLeft != allRows; tx++) {
+			int left = std::max(tx * DEPTH_TILE_SIZE, xMin);
+			int right = std::min(tx * DEPTH_TILE_SIZE + DEPTH_TILE_SIZE - 1, xMax);
+			if (!tri.mayCover(left, right, bottom, top)) {
+				continue;
+			}
+			if (cullHiddenTiles) {
+				tilesTested++;
+				if (tri.zMin >= frameBuffer.getTileMaxDepth(tx, ty)) {
+					tilesHidden++;
+					continue;
+				}
+			}
+			for (int y = bottom; y <= top; y++) {
+				int row = 1 << (y - bottom);
+				if ((rowsLeft & row) != 0) {
+					continue;
+				}
+				long long edges[3];
+				for (int k = 0; k < 3; k++) {
+					edges[k] = tri.edges[k](left, y) + tri.edges[k].bias;
+				}
+				// Calculate the weights for Gouraud inperpolation at the start of the run,
+				// then step them across it
+				float alpha = (edges[0] - tri.edges[0].bias) * tri.invArea;
+				float beta = (edges[1] - tri.edges[1].bias) * tri.invArea;
+				float gamma = (edges[2] - tri.edges[2].bias) * tri.invArea;
+				float z = barycentricWeighting(alpha, beta, gamma, v0.position.z, v1.position.z, v2.position.z);
+				int count = right - left + 1;
+				int mask = coverPixels(tri, edges, z, depthBuffer != nullptr ? depthBuffer + y * W + left : nullptr, count);
+				int covered = mask & ((1 << RASTER_LANES) - 1);
+				if (covered != 0) {
+					rowsEntered |= row;
+				}
+				if ((rowsEntered & row) != 0 && ((covered >> (count - 1)) & 1) == 0) {
+					rowsLeft |= row;
+				}
+				if (coverage != nullptr) {
+					for (int i = 0; i < count; i++) {
+						coverage[y * W + left + i] += (mask >> i) & 1;
+					}
+				}
+				// shade only the pixels that are covered and pass the depth test
+				int drawn = mask >> RASTER_LANES;
+				if (drawn == 0) {
+					continue;
+				}
+				glm::vec3 normal = barycentricWeighting(alpha, beta, gamma, v0.normal, v1.normal, v2.normal);
+				glm::vec3 worldPosition = barycentricWeighting(alpha, beta, gamma,
+																v0.worldPosition, v1.worldPosition, v2.worldPosition);
+				for (int i = 0; drawn != 0; i++, drawn >>= 1) {
+					if ((drawn & 1) == 0) {
+						continue;
+					}
+					Fragment fragment;
+
+					// Interpolate vertex attributes using alpha, beta, and gamma weights
+					if (tri.oneMaterial) {
+						fragment.material = tri.materials[0];
+						fragment.materialIndex = v0.material;
+					} else {
+						blended = barycentricWeighting(alpha + i * tri.dAlpha, beta + i * tri.dBeta,
+														gamma + i * tri.dGamma,
+														*tri.materials[0], *tri.materials[1], *tri.materials[2]);
+						fragment.material = &blended;
+						fragment.materialIndex = -1;
+					}
+					fragment.worldNormal = normal + (float)i * tri.dNormal;
+					fragment.worldPosition = worldPosition + (float)i * tri.dWorldPosition;
+					fragment.windowPosition = glm::vec3(left + i, y, z + i * tri.dz);
+					FragmentOps::processFragment(frameBuffer, eyePos, lights, fragment, viewingMatrix);
+				}
+			}
+		}
+	}
+	if (tilesTested > 0) {
+		occlusionStats.add(tilesTested, tilesHidden);
+	}
 }
 
 /**
@@ -594,66 +1064,164 @@ static inline float f20(const VertexData &v0, const VertexData &v1, const Vertex
 void drawFilledTriangle(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights,
 						const VertexData &v0, const VertexData &v1, const VertexData &v2,
 						const glm::mat4 &viewingMatrix) {
-	// Find minimimum and maximum x and y limits for the triangle
-	float xMin = glm::floor(min(v0.position.x, v1.position.x, v2.position.x));
-	float xMax = glm::ceil(max(v0.position.x, v1.position.x, v2.position.x));
-	float yMin = glm::floor(min(v0.position.y, v1.position.y, v2.position.y));
-	float yMax = glm::ceil(max(v0.position.y, v1.position.y, v2.position.y));
-
-	float fAlpha = f12(v0, v1, v2, v0.position.x, v0.position.y);
-	float fBeta = f20(v0, v1, v2, v1.position.x, v1.position.y);
-	float fGamma = f01(v0, v1, v2, v2.position.x, v2.position.y);
-
-	for (float y = yMin; y <= yMax; y++) {
-		for (float x = xMin; x <= xMax; x++) {	
-			// Calculate the weights for Gouraud inperpolation
-			// If any weight is negative, the fragment is not in the triangle
-			float alpha = f12(v0, v1, v2, x, y) / fAlpha;
-			float beta = f20(v0, v1, v2, x, y) / fBeta;
-			float gamma = f01(v0, v1, v2, x, y) / fGamma;
-
-			// Determine if the pixel position is inside the triangle
-			if (alpha >= 0 && beta >= 0 && gamma >= 0) {
-				if ((alpha > 0 || fAlpha * f12(v0, v1, v2, -1, -1) > 0) &&
-					(beta > 0 || fBeta * f20(v0, v1, v2, -1, -1) > 0) &&
-					(gamma > 0 || fGamma * f01(v0, v1, v2, -1, -1) > 0)) {
+	TriangleSetup tri;
+	if (tri.setup(v0, v1, v2)) {
+		drawFilledTriangleInRect(frameBuffer, eyePos, lights, v0, v1, v2, tri, viewingMatrix,
+									BoundingBoxi(0, frameBuffer.getWindowWidth() - 1, 0, frameBuffer.getWindowHeight() - 1));
+	}
+}
 
-					Fragment fragment;
+// number of triangles drawn between checks of the render control
+static const int TRIANGLES_PER_CHECK = 16;
 
-					// Interpolate vertex attributes using alpha, beta, and gamma weights
-					fragment.material = barycentricWeighting(alpha, beta, gamma,
-															v0.material, v1.material, v2.material);
-					fragment.worldNormal = barycentricWeighting(alpha, beta, gamma,
-																v0.normal, v1.normal, v2.normal);
-					fragment.worldPosition = barycentricWeighting(alpha, beta, gamma,
-																v0.worldPosition, v1.worldPosition, v2.worldPosition);
-					float z = barycentricWeighting(alpha, beta, gamma,
-													v0.position.z, v1.position.z, v2.position.z);
-					fragment.windowPosition = glm::vec3(x, y, z);
-					FragmentOps::processFragment(frameBuffer, eyePos, lights, fragment, viewingMatrix);
-				}
+// side of the square screen tiles that triangles are binned into for multithreaded drawing
+static const int RASTER_TILE_SIZE = 64;
+
+/**
+ * @fn	static bool drawTrianglesInTiles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights, const std::vector<VertexData> &vertices, const glm::mat4 &viewingMatrix, const RenderControl *control, WorkerPool &pool)
+ * @brief	Draws many filled triangles on several threads. The triangles are first
+ * 			set up and binned into the screen tiles their bounding boxes overlap; then each tile
+ * 			is drawn by one thread, which owns that tile's colors and depths. A tile
+ * 			draws its triangles in the order they were given, so every pixel sees
+ * 			the same sequence of fragments as when drawing on one thread.
+ * @param [in,out]	frameBuffer  	Framebuffer.
+ * @param 		  	eyePos		 	Eye position.
+ * @param 		  	lights		 	Vector of lights in scene.
+ * @param 		  	vertices	 	The vector of vertice-triplets.
+ * @param 		  	viewingMatrix	Viewing matrix.
+ * @param 		  	control		 	If not null, checked every few triangles of each tile.
+ * @param [in,out]	pool		 	The threads to draw with.
+ * @return	True if every triangle was drawn, false if drawing was stopped.
+ */
+
+static bool drawTrianglesInTiles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
+								const std::vector<LightSourcePtr> &lights, const std::vector<VertexData> &vertices,
+								const glm::mat4 &viewingMatrix, const RenderControl *control, WorkerPool &pool) {
+	const int W = frameBuffer.getWindowWidth();
+	const int H = frameBuffer.getWindowHeight();
+	const int tilesX = (W + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+	const int tilesY = (H + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+	std::vector<std::vector<int>> bins(tilesX * tilesY);
+	std::vector<TriangleSetup> setups(vertices.size() / 3);
+	for (int i = 0; i < (int)vertices.size() - 2; i += 3) {
+		TriangleSetup &tri = setups[i / 3];
+		if (!tri.setup(vertices[i], vertices[i + 1], vertices[i + 2])) {
+			continue;
+		}
+		// pixels outside the window are never written, so they need no tile
+		int xMin = std::max(tri.xMin, 0);
+		int xMax = std::min(tri.xMax, W - 1);
+		int yMin = std::max(tri.yMin, 0);
+		int yMax = std::min(tri.yMax, H - 1);
+		if (xMin > xMax || yMin > yMax) {
+			continue;
+		}
+		for (int ty = yMin / RASTER_TILE_SIZE; ty <= yMax / RASTER_TILE_SIZE; ty++) {
+			for (int tx = xMin / RASTER_TILE_SIZE; tx <= xMax / RASTER_TILE_SIZE; tx++) {
+				bins[ty * tilesX + tx].push_back(i);
 			}
 		}
 	}
+
+	std::atomic<bool> stopped(false);
+	pool.run(tilesX * tilesY, [&](int tile) {
+		const std::vector<int> &bin = bins[tile];
+		int left = (tile % tilesX) * RASTER_TILE_SIZE;
+		int bottom = (tile / tilesX) * RASTER_TILE_SIZE;
+		BoundingBoxi rect(left, std::min(left + RASTER_TILE_SIZE, W) - 1,
+							bottom, std::min(bottom + RASTER_TILE_SIZE, H) - 1);
+		for (unsigned int j = 0; j < bin.size(); j++) {
+			if (control != nullptr && j % TRIANGLES_PER_CHECK == 0 && control->shouldStop()) {
+				stopped = true;
+				return;
+			}
+			int i = bin[j];
+			drawFilledTriangleInRect(frameBuffer, eyePos, lights, vertices[i], vertices[i + 1], vertices[i + 2],
+										setups[i / 3], viewingMatrix, rect);
+		}
+	});
+	return !stopped;
 }
 
 /**
- * @fn	void drawManyFilledTriangles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights, const std::vector<VertexData> &vertices, const glm::mat4 &viewingMatrix)
+ * @fn	bool drawManyFilledTriangles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights, const std::vector<VertexData> &vertices, const glm::mat4 &viewingMatrix, const RenderControl *control, WorkerPool *pool)
  * @brief	Draw many filled triangles,
  * @param [in,out]	frameBuffer  	Framebuffer.
  * @param 		  	eyePos		 	Eye position.
  * @param 		  	lights		 	Vector of lights in scene.
  * @param 		  	vertices	 	The vector of vertice-triplets.
  * @param 		  	viewingMatrix	Viewing matrix.
+ * @param 		  	control		 	If not null, checked every few triangles; drawing stops
+ * 									when it is cancelled or past its deadline.
+ * @param [in,out]	pool		 	If not null, the triangles are drawn in screen tiles on its threads.
+ * @return	True if every triangle was drawn, false if drawing was stopped.
  */
 
-void drawManyFilledTriangles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, 
+bool drawManyFilledTriangles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, 
 							const std::vector<LightSourcePtr> &lights, const std::vector<VertexData> &vertices,
-							const glm::mat4 &viewingMatrix) {
-	for (int i = 0; i < (int)vertices.size() - 2; i += 3) {
-		const VertexData &Vi = vertices[i];
-		const VertexData &Vi1 = vertices[i+1];
-		const VertexData &Vi2 = vertices[i+2];
-		drawFilledTriangle(frameBuffer, eyePos, lights, Vi, Vi1, Vi2, viewingMatrix);
+							const glm::mat4 &viewingMatrix, const RenderControl *control, WorkerPool *pool) {
+	if (overdrawCounter.enabled) {
+		overdrawCounter.counts.assign(frameBuffer.getWindowWidth() * frameBuffer.getWindowHeight(), 0);
+	}
+	bool finished = true;
+	if (pool != nullptr && pool->numThreads() > 1) {
+		finished = drawTrianglesInTiles(frameBuffer, eyePos, lights, vertices, viewingMatrix, control, *pool);
+	} else {
+		for (int i = 0; i < (int)vertices.size() - 2; i += 3) {
+			if (control != nullptr && (i / 3) % TRIANGLES_PER_CHECK == 0 && control->shouldStop()) {
+				finished = false;
+				break;
+			}
+			const VertexData &Vi = vertices[i];
+			const VertexData &Vi1 = vertices[i+1];
+			const VertexData &Vi2 = vertices[i+2];
+			drawFilledTriangle(frameBuffer, eyePos, lights, Vi, Vi1, Vi2, viewingMatrix);
+		}
+	}
+	if (overdrawCounter.enabled) {
+		overdrawCounter.tally();
+	}
+	return finished;
+}
+
+/**
+ * @fn	void OcclusionStats::reset()
+ * @brief	Zeroes the counts.
+ */
+
+void OcclusionStats::reset() {
+	trianglesTested = 0;
+	trianglesHidden = 0;
+	tilesTested = 0;
+	tilesHidden = 0;
+}
+
+/**
+ * @fn	void OcclusionStats::add(int tiles, int hidden)
+ * @brief	Counts the depth tests of one triangle's tiles.
+ * @param	tiles 	Number of depth tiles the triangle was tested against.
+ * @param	hidden	Number of those tiles where it was hidden.
+ */
+
+void OcclusionStats::add(int tiles, int hidden) {
+	trianglesTested++;
+	if (hidden == tiles) {
+		trianglesHidden++;
+	}
+	tilesTested += tiles;
+	tilesHidden += hidden;
+}
+
+/**
+ * @fn	void OverdrawCounter::tally()
+ * @brief	Adds the coverage counted during a draw call to the totals.
+ */
+
+void OverdrawCounter::tally() {
+	for (unsigned int i = 0; i < counts.size(); i++) {
+		if (counts[i] > 0) {
+			pixelsCovered++;
+			extraCoverage += counts[i] - 1;
+		}
 	}
 }
\ No newline at end of file
@@ -1,8 +1,54 @@
 #pragma once
 
+#include <atomic>
 #include "Defs.h"
 #include "FragmentOps.h"
 #include "VertexData.h"
+#include "RenderControl.h"
+#include "WorkerPool.h"
+
+/**
+ * @struct	OverdrawCounter
+ * @brief	Counts how often the triangles of each call to drawManyFilledTriangles
+ * 			cover the same pixel, before depth testing. A mesh whose triangles do
+ * 			not overlap, such as a closed mesh drawn with its back faces culled,
+ * 			should cover each pixel at most once, including the pixels on its
+ * 			shared edges.
+ */
+
+struct OverdrawCounter {
+	bool enabled;						//!< True to count; counting slows drawing
+	long long pixelsCovered;			//!< pixels covered by each draw call, summed since the last reset
+	long long extraCoverage;			//!< times those pixels were covered again by the same draw call
+	std::vector<unsigned short> counts;	//!< coverage of each pixel by the current draw call
+	OverdrawCounter() : enabled(false), pixelsCovered(0), extraCoverage(0) {}
+	void reset() { pixelsCovered = extraCoverage = 0; }
+	void tally();
+};
+
+/**
+ * @struct	OcclusionStats
+ * @brief	Counts how often filled triangles are rejected a depth tile at a time,
+ * 			because they are behind the largest depth already in the tile. A
+ * 			triangle is hidden when every tile it may cover rejects it; when
+ * 			drawing on several threads, each screen tile a triangle is drawn in
+ * 			counts as a triangle.
+ */
+
+struct OcclusionStats {
+	std::atomic<long long> trianglesTested;	//!< triangles tested against the depth tiles
+	std::atomic<long long> trianglesHidden;	//!< triangles rejected by all of their tiles
+	std::atomic<long long> tilesTested;		//!< depth tiles tested
+	std::atomic<long long> tilesHidden;		//!< depth tiles rejected
+	OcclusionStats() { reset(); }
+	void reset();
+	void add(int tiles, int hidden);
+};
+
+extern bool vectorizedCoverage;		//!< False to evaluate triangle coverage one pixel at a time
+extern bool hierarchicalDepthTest;	//!< False to depth test every covered pixel
+extern OverdrawCounter overdrawCounter;
+extern OcclusionStats occlusionStats;
 
 void drawAxisOnWindow(FrameBuffer &frameBuffer);
 void drawWirePolygon(FrameBuffer &frameBuffer, const std::vector<glm::vec3> &pts, const color &rgb);
@@ -22,8 +68,10 @@ void drawFilledTriangle(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, std::
 void drawManyWireFrameTriangles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, 
 								const std::vector<LightSourcePtr> &lights, const std::vector<VertexData> &vertices,
 								const glm::mat4 &viewingMatrix);
-void drawManyFilledTriangles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
+bool drawManyFilledTriangles(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 							const std::vector<LightSourcePtr> &lights, const std::vector<VertexData> &vertices,
-								const glm::mat4 &viewingMatrix);
+								const glm::mat4 &viewingMatrix, const RenderControl *control = nullptr,
+								WorkerPool *pool = nullptr);
+const char *coveragePathName();
 void drawArc(FrameBuffer &fb, const glm::vec2 &center, float R,
 	float startRads, float lengthInRads, const color &rgb);
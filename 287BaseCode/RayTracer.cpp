@@ -1,6 +1,173 @@
+#include <algorithm>
 #include "RayTracer.h"
 #include "IShape.h"
 
+/**
+ * @fn	LightState::LightState(const PositionalLight &light)
+ * @brief	Records the current state of a light.
+ * @param	light	The light.
+ */
+
+LightState::LightState(const PositionalLight &light)
+	: position(light.lightPosition), isOn(light.isOn),
+	attenuationIsTurnedOn(light.attenuationIsTurnedOn), isTiedToWorld(light.isTiedToWorld),
+	attenuationParams(light.attenuationParams),
+	ambient(light.lightColorComponents.ambient), diffuse(light.lightColorComponents.diffuse),
+	specular(light.lightColorComponents.specular), spotDirection(ZEROVEC), fov(0.0f) {
+	const SpotLight *spot = dynamic_cast<const SpotLight *>(&light);
+	if (spot != nullptr) {
+		spotDirection = spot->spotDirection;
+		fov = spot->fov;
+	}
+}
+
+/**
+ * @fn	bool LightState::operator == (const LightState &other) const
+ * @brief	Equality operator.
+ * @param	other	The other light state.
+ * @return	True iff the light would shade identically.
+ */
+
+bool LightState::operator == (const LightState &other) const {
+	return position == other.position && isOn == other.isOn &&
+			attenuationIsTurnedOn == other.attenuationIsTurnedOn &&
+			isTiedToWorld == other.isTiedToWorld &&
+			attenuationParams.constant == other.attenuationParams.constant &&
+			attenuationParams.linear == other.attenuationParams.linear &&
+			attenuationParams.quadratic == other.attenuationParams.quadratic &&
+			ambient == other.ambient && diffuse == other.diffuse && specular == other.specular &&
+			spotDirection == other.spotDirection && fov == other.fov;
+}
+
+/**
+ * @fn	SceneState::SceneState()
+ * @brief	Constructs an empty scene state, which matches no frame.
+ */
+
+SceneState::SceneState()
+	: camera(nullptr), cameraId(0), cameraVersion(0), left(0), bottom(0), width(0), height(0),
+	depth(0), aaValue(0), previewFactor(1), numTransparent(0) {
+}
+
+/**
+ * @fn	SceneState::SceneState(const IScene &theScene, int depth, int aaValue)
+ * @brief	Records the state of a scene about to be traced. The view-dependent
+ * 			fields are filled in by setView.
+ * @param	theScene	The scene.
+ * @param	depth   	The recursion depth.
+ * @param	aaValue 	The antialiasing value.
+ */
+
+SceneState::SceneState(const IScene &theScene, int depth, int aaValue)
+	: camera(nullptr), cameraId(0), cameraVersion(0), left(0), bottom(0), width(0), height(0),
+	depth(depth), aaValue(aaValue), previewFactor(1),
+	numTransparent((int)theScene.transparentObjects.size()) {
+	for (unsigned int i = 0; i < theScene.lights.size(); i++) {
+		lights.push_back(LightState(*theScene.lights[i]));
+	}
+	for (unsigned int i = 0; i < theScene.visibleObjects.size(); i++) {
+		BoundingBox3D box(ORIGIN3D, ORIGIN3D);
+		bool bounded = theScene.visibleObjects[i]->shape->getBounds(box);
+		isBounded.push_back(bounded);
+		bounds.push_back(box);
+		materials.push_back(theScene.visibleObjects[i]->material);
+		textures.push_back(theScene.visibleObjects[i]->texture);
+	}
+}
+
+/**
+ * @fn	void SceneState::setView(const RaytracingView &view)
+ * @brief	Records the camera and size of the view being traced.
+ * @param	view	The view.
+ */
+
+void SceneState::setView(const RaytracingView &view) {
+	camera = view.camera;
+	cameraId = view.camera->id;
+	cameraVersion = view.camera->version;
+	left = view.left;
+	bottom = view.bottom;
+	width = view.width;
+	height = view.height;
+}
+
+/**
+ * @fn	CachedHit::CachedHit()
+ * @brief	Constructs a cached hit that corresponds to "no hit".
+ */
+
+CachedHit::CachedHit()
+	: t(FLT_MAX), objectIndex(-1), u(0.0f), v(0.0f) {
+}
+
+/**
+ * @fn	CachedHit::CachedHit(const HitRecord &hit, int index)
+ * @brief	Records the geometric part of a hit.
+ * @param	hit  	The hit.
+ * @param	index	Index of the object that was hit, or -1 if none.
+ */
+
+CachedHit::CachedHit(const HitRecord &hit, int index)
+	: t(hit.t), interceptPoint(hit.interceptPoint), surfaceNormal(hit.surfaceNormal),
+	objectIndex(index), u(hit.u), v(hit.v) {
+}
+
+/**
+ * @fn	HitRecord CachedHit::toHitRecord(const std::vector<VisibleIShapePtr> &objects) const
+ * @brief	Rebuilds the full hit, using the current material and texture of the object.
+ * @param	objects	The objects the index refers to.
+ * @return	The hit record.
+ */
+
+HitRecord CachedHit::toHitRecord(const std::vector<VisibleIShapePtr> &objects) const {
+	HitRecord hit;
+	if (objectIndex >= 0) {
+		hit.t = t;
+		hit.interceptPoint = interceptPoint;
+		hit.surfaceNormal = surfaceNormal;
+		hit.material = objects[objectIndex]->material;
+		hit.texture = objects[objectIndex]->texture;
+		hit.u = u;
+		hit.v = v;
+	}
+	return hit;
+}
+
+/**
+ * @fn	RaytracingView::RaytracingView(RaytracingCamera *cam, int L, int B, int W, int H)
+ * @brief	Constructs a view.
+ * @param [in,out]	cam	The camera.
+ * @param 		  	L  	Left edge of the viewport.
+ * @param 		  	B  	Bottom edge of the viewport.
+ * @param 		  	W  	Width of the viewport.
+ * @param 		  	H  	Height of the viewport.
+ */
+
+RaytracingView::RaytracingView(RaytracingCamera *cam, int L, int B, int W, int H)
+	: camera(cam), left(L), bottom(B), width(W), height(H) {
+}
+
+/**
+ * @fn	ViewState::ViewState()
+ * @brief	Constructs the state of a view that has not been traced yet.
+ */
+
+ViewState::ViewState()
+	: hasPreviousState(false), cacheIsValid(false), tilesX(0), tilesY(0), fromCache(false),
+	recordHits(false), useTileObjects(false), previewFactor(1), keepHistory(false),
+	checkerboard(false), parity(0), hasHistory(false) {
+}
+
+/**
+ * @fn	TracingOptions::TracingOptions()
+ * @brief	Constructs the default options.
+ */
+
+TracingOptions::TracingOptions()
+	: dirtyRegionTracing(false), relightingCache(false), tileObjectLists(true), previewFactor(1),
+	checkerboardRendering(false), shadowCasterLists(true), lightHierarchy(true), sampledLights(0) {
+}
+
 /**
  * @fn	RayTracer::RayTracer(const color &defa)
  * @brief	Constructs a raytracers.
@@ -8,73 +175,829 @@
  */
 
 RayTracer::RayTracer(const color &defa)
-	: defaultColor(defa) {
+	: defaultColor(defa), lightSamples(0) {
 }
 
 /**
- * @fn	void RayTracer::raytraceScene(FrameBuffer &frameBuffer, int depth, const IScene &theScene) const
- * @brief	Raytrace scene
+ * @fn	void RayTracer::raytraceScene(FrameBuffer &frameBuffer, int depth, const IScene &theScene, int aaValue)
+ * @brief	Raytrace scene, as seen by the scene's camera, into the whole frame buffer.
  * @param [in,out]	frameBuffer	Framebuffer.
  * @param 		  	depth	   	The current depth of recursion.
  * @param 		  	theScene   	The scene.
+ * @param 		  	aaValue	   	1 for no antialiasing, 3 for 9 samples per pixel.
  */
 
-// add boolean for two vantage points
-// go through another nested forloop if true
 void RayTracer::raytraceScene(FrameBuffer &frameBuffer, int depth,
-								const IScene &theScene, int aaValue) const {
-	const RaytracingCamera &camera = *theScene.camera;
-	const std::vector<VisibleIShapePtr> &objs = theScene.visibleObjects;
-	const std::vector<PositionalLightPtr> &lights = theScene.lights;
-	// where major changes for raytracing project will be
-	if (aaValue == 1) {
-		for (int y = 0; y < frameBuffer.getWindowHeight(); ++y) {
-			for (int x = 0; x < frameBuffer.getWindowWidth(); ++x) {
-				Ray ray = camera.getRay((float)x, (float)y);
-				color colorForPixel = traceIndividualRay(ray, theScene, depth);
-				frameBuffer.setColor(x, y, colorForPixel);
-			}
-		}
-	}
-	if (aaValue == 3) {
-		for (int y = 0; y < frameBuffer.getWindowHeight(); ++y) {
-			for (int x = 0; x < frameBuffer.getWindowWidth(); ++x) {
-				Ray ray = camera.getRay((float)x, (float)y);
-				Ray leftMid = camera.getRay((float)x - EPSILON * 500, (float)y);
-				Ray rightMid = camera.getRay((float)x + EPSILON * 500, (float)y);
-				Ray upMid = camera.getRay((float)x, (float)y + EPSILON * 500);
-				Ray downMid = camera.getRay((float)x, (float)y + EPSILON * 500);
-				Ray upLeft = camera.getRay((float)x - EPSILON * 500, (float)y + EPSILON * 500);
-				Ray upRight = camera.getRay((float)x + EPSILON * 500, (float)y + EPSILON * 500);
-				Ray botLeft = camera.getRay((float)x - EPSILON * 500, (float)y - EPSILON * 500);
-				Ray botRight = camera.getRay((float)x + EPSILON * 500, (float)y - EPSILON * 500);
-				
-				color colorForPixel = traceIndividualRay(ray, theScene, depth);
-				color colorForLeftMid = traceIndividualRay(leftMid, theScene, depth);
-				color colorForRightMid = traceIndividualRay(rightMid, theScene, depth);
-				color colorForUpMid = traceIndividualRay(upMid, theScene, depth);
-				color colorForDownMid = traceIndividualRay(downMid, theScene, depth);
-				color colorForUpLeft = traceIndividualRay(upLeft, theScene, depth);
-				color colorForUpRight = traceIndividualRay(upRight, theScene, depth);
-				color colorForBotLeft = traceIndividualRay(botLeft, theScene, depth);
-				color colorForBotRight = traceIndividualRay(botRight, theScene, depth);
-				color finalPixelColor = (colorForPixel + colorForLeftMid + colorForRightMid +
-										colorForUpMid + colorForDownMid + colorForUpLeft + 
-										colorForUpRight + colorForBotLeft + colorForBotRight);
-				finalPixelColor = finalPixelColor / 9.0f;
-				frameBuffer.setColor(x, y, finalPixelColor);
+								const IScene &theScene, int aaValue) {
+	std::vector<RaytracingView> views;
+	views.push_back(RaytracingView(theScene.camera, 0, 0,
+									frameBuffer.getWindowWidth(), frameBuffer.getWindowHeight()));
+	raytraceViews(frameBuffer, depth, theScene, aaValue, views);
+}
+
+/**
+ * @fn	bool RayTracer::raytraceViews(FrameBuffer &frameBuffer, int depth, const IScene &theScene, int aaValue, const std::vector<RaytracingView> &views, const RenderControl *control, std::vector<int> *completedTiles)
+ * @brief	Raytraces the scene from several cameras, each into its own viewport of the
+ * 			frame buffer. The scene is snapshotted once per frame, and the views are traced
+ * 			in interleaved tiles so that neighboring work touches the same objects.
+ * 			When dirtyRegionTracing is on, only the tiles affected by objects that moved
+ * 			since the previous frame are re-traced, and the rest of the viewport is left
+ * 			as it was. When relightingCache is on and neither the camera nor the geometry
+ * 			has changed, a view is re-shaded from its cached primary hits.
+ * @param [in,out]	frameBuffer	Framebuffer.
+ * @param 		  	depth	   	The current depth of recursion.
+ * @param 		  	theScene   	The scene.
+ * @param 		  	aaValue	   	1 for no antialiasing, 3 for 9 samples per pixel.
+ * @param 		  	views	   	The views to render.
+ * @param 		  	control	   	If not null, checked before each tile; the frame stops
+ * 								when it is cancelled or past its deadline.
+ * @param [out]		completedTiles	If not null, receives the interleaved tiles that were traced.
+ * @return	True if the whole frame was traced, false if it was stopped part way.
+ */
+
+bool RayTracer::raytraceViews(FrameBuffer &frameBuffer, int depth, const IScene &theScene,
+								int aaValue, const std::vector<RaytracingView> &views,
+								const RenderControl *control, std::vector<int> *completedTiles) {
+	int maxTiles = beginFrame(theScene, depth, aaValue, views);
+	if (completedTiles != nullptr) {
+		completedTiles->clear();
+	}
+	bool isComplete = true;
+	for (int tile = 0; tile < maxTiles; ++tile) {
+		if (control != nullptr && control->shouldStop()) {
+			isComplete = false;
+			break;
+		}
+		traceInterleavedTile(frameBuffer, theScene, tile, depth, aaValue, views);
+		if (completedTiles != nullptr) {
+			completedTiles->push_back(tile);
+		}
+	}
+	if (!isComplete) {
+		invalidateViews();
+	}
+	frameBuffer.showColorBuffer();
+	return isComplete;
+}
+
+/**
+ * @fn	int RayTracer::beginFrame(const IScene &theScene, int depth, int aaValue, const std::vector<RaytracingView> &views)
+ * @brief	Snapshots the scene and plans the tiles of each view for a new frame.
+ * 			The frame is then traced by calling traceInterleavedTile for each tile
+ * 			number. Tiles may be traced in any order and from several threads, as
+ * 			long as each tile number is traced once.
+ * @param	theScene	The scene.
+ * @param	depth   	The recursion depth.
+ * @param	aaValue 	1 for no antialiasing, 3 for 9 samples per pixel.
+ * @param	views   	The views to render.
+ * @return	The number of interleaved tiles in the frame.
+ */
+
+int RayTracer::beginFrame(const IScene &theScene, int depth, int aaValue,
+							const std::vector<RaytracingView> &views) {
+	SceneState frameState(theScene, depth, aaValue);
+	findShadowCasters(theScene, views);
+	lightTree.build(theScene.lights, options.lightHierarchy);
+	lightSamples = options.sampledLights;
+	viewStates.resize(views.size());
+	int maxTiles = 0;
+	for (unsigned int v = 0; v < views.size(); v++) {
+		planView(views[v], viewStates[v], frameState, theScene);
+		maxTiles = std::max(maxTiles, viewStates[v].tilesX * viewStates[v].tilesY);
+	}
+	return maxTiles;
+}
+
+/**
+ * @fn	void RayTracer::traceInterleavedTile(FrameBuffer &frameBuffer, const IScene &theScene, int tile, int depth, int aaValue, const std::vector<RaytracingView> &views)
+ * @brief	Traces one tile number in every view that has it, if it is dirty.
+ * @param [in,out]	frameBuffer	Framebuffer.
+ * @param 		  	theScene   	The scene.
+ * @param 		  	tile	   	Index of the tile, in row-major order.
+ * @param 		  	depth	   	The recursion depth.
+ * @param 		  	aaValue	   	1 for no antialiasing, 3 for 9 samples per pixel.
+ * @param 		  	views	   	The views passed to beginFrame.
+ */
+
+void RayTracer::traceInterleavedTile(FrameBuffer &frameBuffer, const IScene &theScene, int tile,
+										int depth, int aaValue, const std::vector<RaytracingView> &views) {
+	for (unsigned int v = 0; v < views.size(); v++) {
+		ViewState &state = viewStates[v];
+		if (tile < state.tilesX * state.tilesY && state.dirtyTiles[tile]) {
+			traceTile(frameBuffer, views[v], state, theScene, tile, depth, aaValue);
+		}
+	}
+}
+
+/**
+ * @fn	void RayTracer::findShadowCasters(const IScene &theScene, const std::vector<RaytracingView> &views)
+ * @brief	Lists, for each light, the objects that may lie between it and a lit
+ * 			surface. An unbounded plane with the light and every camera on the same
+ * 			side stops every ray before it reaches the far side, so it cannot shadow
+ * 			anything, and neither can the objects wholly behind it. A spot light is
+ * 			only shadowed by objects its cone reaches. Shadow feelers for the light
+ * 			then skip the other objects.
+ * @param	theScene	The scene.
+ * @param	views   	The views of the frame, whose rays start on the cameras' side of the planes.
+ */
+
+void RayTracer::findShadowCasters(const IScene &theScene, const std::vector<RaytracingView> &views) {
+	shadowCasters.clear();
+	if (!options.shadowCasterLists) {
+		return;
+	}
+	const std::vector<VisibleIShapePtr> &objects = theScene.visibleObjects;
+	std::vector<BoundingBox3D> bounds(objects.size(), BoundingBox3D(ZEROVEC, ZEROVEC));
+	std::vector<bool> isBounded(objects.size());
+	for (unsigned int j = 0; j < objects.size(); j++) {
+		isBounded[j] = objects[j]->shape->getBounds(bounds[j]);
+	}
+	// the rays of every view start within the hull of its corner rays' origins
+	std::vector<glm::vec3> rayOrigins;
+	for (unsigned int v = 0; v < views.size(); v++) {
+		const RaytracingView &view = views[v];
+		rayOrigins.push_back(view.camera->getRay(-1.0f, -1.0f).origin);
+		rayOrigins.push_back(view.camera->getRay(view.width + 1.0f, -1.0f).origin);
+		rayOrigins.push_back(view.camera->getRay(-1.0f, view.height + 1.0f).origin);
+		rayOrigins.push_back(view.camera->getRay(view.width + 1.0f, view.height + 1.0f).origin);
+	}
+
+	shadowCasters.resize(theScene.lights.size());
+	for (unsigned int i = 0; i < theScene.lights.size(); i++) {
+		const PositionalLight &light = *theScene.lights[i];
+		std::vector<const IPlane *> blockers;
+		for (unsigned int j = 0; j < objects.size(); j++) {
+			const IPlane *plane = dynamic_cast<const IPlane *>(objects[j]->shape);
+			if (isBounded[j] || plane == nullptr) {
+				continue;
+			}
+			float lightSide = glm::dot(light.lightPosition - plane->a, plane->n);
+			bool isBlocker = std::abs(lightSide) > EPSILON && !rayOrigins.empty();
+			for (unsigned int k = 0; k < rayOrigins.size() && isBlocker; k++) {
+				isBlocker = glm::dot(rayOrigins[k] - plane->a, plane->n) * lightSide > 0.0f;
+			}
+			if (isBlocker) {
+				blockers.push_back(plane);
+			}
+		}
+		for (unsigned int j = 0; j < objects.size(); j++) {
+			const IPlane *plane = dynamic_cast<const IPlane *>(objects[j]->shape);
+			if (!isBounded[j]) {
+				if (std::find(blockers.begin(), blockers.end(), plane) == blockers.end()) {
+					shadowCasters[i].push_back(j);
+				}
+				continue;
+			}
+			if (!light.mayIlluminate(bounds[j])) {
+				continue;
+			}
+			bool isBehindBlocker = false;
+			for (unsigned int b = 0; b < blockers.size() && !isBehindBlocker; b++) {
+				// shadow feelers start at most EPSILON behind a blocker
+				float lightSign = glm::dot(light.lightPosition - blockers[b]->a, blockers[b]->n) > 0.0f ? 1.0f : -1.0f;
+				isBehindBlocker = true;
+				for (int corner = 0; corner < 8 && isBehindBlocker; corner++) {
+					float side = lightSign * glm::dot(bounds[j].getCorner(corner) - blockers[b]->a, blockers[b]->n);
+					isBehindBlocker = side < -2.0f * EPSILON;
+				}
+			}
+			if (!isBehindBlocker) {
+				shadowCasters[i].push_back(j);
 			}
 		}
 	}
+}
 
-	frameBuffer.showColorBuffer();
+/**
+ * @fn	void RayTracer::invalidateViews()
+ * @brief	Forgets what was traced into the previous frame, so that the next frame
+ * 			is traced in full. Used when a frame was abandoned before all of its
+ * 			tiles were traced.
+ */
+
+void RayTracer::invalidateViews() {
+	for (unsigned int v = 0; v < viewStates.size(); v++) {
+		viewStates[v].hasPreviousState = false;
+		viewStates[v].cacheIsValid = false;
+		viewStates[v].hasHistory = false;
+	}
+}
+
+/**
+ * @fn	void RayTracer::planView(const RaytracingView &view, ViewState &state, const SceneState &frameState, const IScene &theScene)
+ * @brief	Decides which tiles of a view are traced this frame, and whether they are
+ * 			traced or re-shaded from the cache.
+ * @param 		  	view	  	The view.
+ * @param [in,out]	state	  	The view's state.
+ * @param 		  	frameState	Snapshot of the scene for this frame.
+ * @param 		  	theScene  	The scene.
+ */
+
+void RayTracer::planView(const RaytracingView &view, ViewState &state, const SceneState &frameState,
+							const IScene &theScene) {
+	// primary ray directions are only rebuilt when the camera has changed
+	view.camera->updateRayCache();
+	int numSamples = (frameState.aaValue == 3) ? 9 : 1;
+	SceneState currentState = frameState;
+	currentState.setView(view);
+	state.previewFactor = std::max(options.previewFactor, 1);
+	currentState.previewFactor = state.previewFactor;
+	state.tilesX = (view.width + TILE_SIZE - 1) / TILE_SIZE;
+	state.tilesY = (view.height + TILE_SIZE - 1) / TILE_SIZE;
+	state.fromCache = false;
+	planHistory(view, state, currentState);
+	if (state.keepHistory) {
+		// every pixel of the frame is recorded, so every tile is traced
+		state.dirtyTiles.assign(state.tilesX * state.tilesY, true);
+		state.cacheIsValid = false;
+	} else if (options.dirtyRegionTracing && findDirtyTiles(state, currentState, theScene)) {
+		// the cache stays valid if the re-traced tiles are recorded into it
+		state.cacheIsValid = state.cacheIsValid && options.relightingCache;
+	} else {
+		state.dirtyTiles.assign(state.tilesX * state.tilesY, true);
+		state.fromCache = options.relightingCache && state.cacheIsValid &&
+							currentState.depth == 0 && sameGeometry(state, currentState);
+		state.cacheIsValid = options.relightingCache;
+	}
+	// the flags are latched for the frame, since the options may change before its tiles are traced
+	state.recordHits = options.relightingCache;
+	if ((state.previewFactor > 1 && !state.fromCache) || state.keepHistory) {
+		// not every pixel is traced, so the cached hits would be stale
+		state.recordHits = false;
+		state.cacheIsValid = false;
+	}
+	state.useTileObjects = options.tileObjectLists && !state.fromCache;
+	if (state.recordHits) {
+		state.primaryHits.resize(view.width * view.height * numSamples);
+		state.transparentHits.resize(view.width * view.height * numSamples);
+	}
+	state.previousState = currentState;
+	state.hasPreviousState = true;
+	if (state.useTileObjects) {
+		binObjects(state, *view.camera, theScene, view.width, view.height);
+	}
+}
+
+/**
+ * @fn	void RayTracer::traceTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state, const IScene &theScene, int tile, int depth, int aaValue)
+ * @brief	Traces the pixels of one tile of a view.
+ * @param [in,out]	frameBuffer	Framebuffer.
+ * @param 		  	view	   	The view.
+ * @param [in,out]	state	   	The view's state.
+ * @param 		  	theScene   	The scene.
+ * @param 		  	tile	   	Index of the tile, in row-major order.
+ * @param 		  	depth	   	The recursion depth.
+ * @param 		  	aaValue	   	1 for no antialiasing, 3 for 9 samples per pixel.
+ */
+
+void RayTracer::traceTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state,
+							const IScene &theScene, int tile, int depth, int aaValue) {
+	int numSamples = (aaValue == 3) ? 9 : 1;
+	int tx = tile % state.tilesX;
+	int ty = tile / state.tilesX;
+	const std::vector<int> *candidates = nullptr;
+	if (state.useTileObjects) {
+		candidates = &state.tileObjects[tile];
+	}
+	if (state.previewFactor > 1) {
+		tracePreviewTile(frameBuffer, view, state, theScene, tile, depth, aaValue, candidates);
+		return;
+	}
+	if (state.checkerboard) {
+		traceCheckerboardTile(frameBuffer, view, state, theScene, tile, depth, aaValue, candidates);
+		return;
+	}
+	int xEnd = std::min((tx + 1) * TILE_SIZE, view.width);
+	int yEnd = std::min((ty + 1) * TILE_SIZE, view.height);
+	for (int y = ty * TILE_SIZE; y < yEnd; ++y) {
+		for (int x = tx * TILE_SIZE; x < xEnd; ++x) {
+			int cacheIndex = (y * view.width + x) * numSamples;
+			PreviewSample sample;
+			sample.C = tracePixel(*view.camera, state, theScene, x, y, depth, aaValue,
+									cacheIndex, candidates, &sample);
+			setViewPixel(frameBuffer, view, state, x, y, sample.C, sample.t);
+		}
+	}
+}
+
+/**
+ * @fn	void RayTracer::planHistory(const RaytracingView &view, ViewState &state, const SceneState &currentState) const
+ * @brief	Decides whether a view's frame is recorded for reprojection, and whether
+ * 			it can be a checkerboard frame. A checkerboard frame needs the previous
+ * 			frame to have been recorded at the same size.
+ * @param 		  	view		The view.
+ * @param [in,out]	state		The view's state; previousState still describes the previous frame.
+ * @param 		  	currentState	State of the scene about to be traced.
+ */
+
+void RayTracer::planHistory(const RaytracingView &view, ViewState &state, const SceneState &currentState) const {
+	state.keepHistory = options.checkerboardRendering && state.previewFactor == 1;
+	if (!state.keepHistory) {
+		state.checkerboard = false;
+		state.hasHistory = false;
+		state.previousCamera.reset();
+		state.currentCamera.reset();
+		return;
+	}
+	const SceneState &prev = state.previousState;
+	state.checkerboard = state.hasHistory && state.hasPreviousState &&
+						prev.width == currentState.width && prev.height == currentState.height &&
+						prev.aaValue == currentState.aaValue && state.currentCamera != nullptr;
+	std::swap(state.previousColors, state.currentColors);
+	std::swap(state.previousDepths, state.currentDepths);
+	state.currentColors.resize(view.width * view.height);
+	state.currentDepths.resize(view.width * view.height);
+	state.previousCamera = state.currentCamera;
+	if (state.currentCamera == nullptr || state.currentCamera->id != view.camera->id ||
+		state.currentCamera->version != view.camera->version) {
+		state.currentCamera.reset(view.camera->clone());
+	}
+	state.parity ^= 1;
+	// recorded for the next frame, unless this one is abandoned
+	state.hasHistory = true;
+}
+
+/**
+ * @fn	void RayTracer::setViewPixel(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state, int x, int y, const color &C, float t) const
+ * @brief	Writes a pixel of a view, and records it when the frame is kept for reprojection.
+ * @param [in,out]	frameBuffer	Framebuffer.
+ * @param 		  	view	   	The view.
+ * @param [in,out]	state	   	The view's state.
+ * @param 		  	x		   	The x coordinate of the pixel, within the view.
+ * @param 		  	y		   	The y coordinate of the pixel, within the view.
+ * @param 		  	C		   	The color.
+ * @param 		  	t		   	The t value of the primary hit (FLT_MAX if none).
+ */
+
+void RayTracer::setViewPixel(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state,
+								int x, int y, const color &C, float t) const {
+	frameBuffer.setPixel(view.left + x, view.bottom + y, C, t);
+	if (state.keepHistory) {
+		state.currentColors[y * view.width + x] = C;
+		state.currentDepths[y * view.width + x] = t;
+	}
+}
+
+// relative difference between the expected and recorded depth at which a reprojected pixel is rejected.
+static const float REPROJECTION_TOLERANCE = 0.02f;
+
+/**
+ * @fn	void RayTracer::traceCheckerboardTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state, const IScene &theScene, int tile, int depth, int aaValue, const std::vector<int> *candidates)
+ * @brief	Traces half of the pixels of a tile, in a checkerboard pattern that
+ * 			alternates every frame, and reconstructs the others. A reconstructed
+ * 			pixel takes its depth from its traced neighbors in the tile and is
+ * 			reprojected into the previous frame. If the previous frame saw something
+ * 			else there (the pixel was disoccluded), the neighbors are averaged instead.
+ * @param [in,out]	frameBuffer	Framebuffer.
+ * @param 		  	view	   	The view.
+ * @param [in,out]	state	   	The view's state.
+ * @param 		  	theScene   	The scene.
+ * @param 		  	tile	   	Index of the tile, in row-major order.
+ * @param 		  	depth	   	The recursion depth.
+ * @param 		  	aaValue	   	1 for no antialiasing, 3 for 9 samples per pixel.
+ * @param 		  	candidates 	The visible objects the primary rays may hit, or nullptr for all of them.
+ */
+
+void RayTracer::traceCheckerboardTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state,
+										const IScene &theScene, int tile, int depth, int aaValue,
+										const std::vector<int> *candidates) {
+	int numSamples = (aaValue == 3) ? 9 : 1;
+	int x0 = (tile % state.tilesX) * TILE_SIZE;
+	int y0 = (tile / state.tilesX) * TILE_SIZE;
+	int xEnd = std::min(x0 + TILE_SIZE, view.width);
+	int yEnd = std::min(y0 + TILE_SIZE, view.height);
+	for (int y = y0; y < yEnd; ++y) {
+		for (int x = x0 + ((x0 + y + state.parity) & 1); x < xEnd; x += 2) {
+			int cacheIndex = (y * view.width + x) * numSamples;
+			PreviewSample sample;
+			sample.C = tracePixel(*view.camera, state, theScene, x, y, depth, aaValue,
+									cacheIndex, candidates, &sample);
+			setViewPixel(frameBuffer, view, state, x, y, sample.C, sample.t);
+		}
+	}
+
+	static const int NEIGHBORS[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	for (int y = y0; y < yEnd; ++y) {
+		for (int x = x0 + ((x0 + y + state.parity + 1) & 1); x < xEnd; x += 2) {
+			color average = black;
+			int count = 0;
+			float nearT = FLT_MAX, farT = 0.0f;
+			for (int n = 0; n < 4; n++) {
+				int nx = x + NEIGHBORS[n][0], ny = y + NEIGHBORS[n][1];
+				if (nx < x0 || nx >= xEnd || ny < y0 || ny >= yEnd) {
+					continue;
+				}
+				int index = ny * view.width + nx;
+				average += state.currentColors[index];
+				nearT = std::min(nearT, state.currentDepths[index]);
+				farT = std::max(farT, state.currentDepths[index]);
+				count++;
+			}
+			if (count == 0) {
+				int cacheIndex = (y * view.width + x) * numSamples;
+				PreviewSample sample;
+				sample.C = tracePixel(*view.camera, state, theScene, x, y, depth, aaValue,
+										cacheIndex, candidates, &sample);
+				setViewPixel(frameBuffer, view, state, x, y, sample.C, sample.t);
+				continue;
+			}
+			// the pixel sees either the nearest or the farthest of its neighbors' surfaces
+			color C;
+			if (reprojectPixel(view, state, x, y, nearT, C)) {
+				setViewPixel(frameBuffer, view, state, x, y, C, nearT);
+			} else if (farT != nearT && reprojectPixel(view, state, x, y, farT, C)) {
+				setViewPixel(frameBuffer, view, state, x, y, C, farT);
+			} else {
+				setViewPixel(frameBuffer, view, state, x, y, average / (float)count, nearT);
+			}
+		}
+	}
+}
+
+/**
+ * @fn	bool RayTracer::reprojectPixel(const RaytracingView &view, const ViewState &state, int x, int y, float t, color &C) const
+ * @brief	Looks up a pixel of this frame in the previous frame, assuming its primary
+ * 			ray hits at a given t. The lookup fails if the point is outside the previous
+ * 			frame, or the previous frame recorded a different depth there.
+ * @param 		  	view 	The view.
+ * @param 		  	state	The view's state.
+ * @param 		  	x	 	The x coordinate of the pixel, within the view.
+ * @param 		  	y	 	The y coordinate of the pixel, within the view.
+ * @param 		  	t	 	The assumed t value of the pixel's primary hit.
+ * @param [in,out]	C	 	The color found in the previous frame.
+ * @return	True iff the previous frame had the point.
+ */
+
+bool RayTracer::reprojectPixel(const RaytracingView &view, const ViewState &state, int x, int y,
+								float t, color &C) const {
+	if (t == FLT_MAX) {
+		return false;
+	}
+	glm::vec3 pt = view.camera->getPixelRay(x, y).getPoint(t);
+	glm::vec2 windowPt;
+	if (!state.previousCamera->projectToWindow(pt, windowPt)) {
+		return false;
+	}
+	int px = (int)std::floor(windowPt.x + 0.5f);
+	int py = (int)std::floor(windowPt.y + 0.5f);
+	if (px < 0 || px >= view.width || py < 0 || py >= view.height) {
+		return false;
+	}
+	Ray previousRay = state.previousCamera->getPixelRay(px, py);
+	float expectedT = glm::dot(pt - previousRay.origin, previousRay.direction);
+	float recordedT = state.previousDepths[py * view.width + px];
+	if (std::abs(recordedT - expectedT) > REPROJECTION_TOLERANCE * expectedT) {
+		return false;
+	}
+	C = state.previousColors[py * view.width + px];
+	return true;
 }
 
+// largest number of reduced resolution samples per tile row (factor 2, plus the far edge).
+static const int MAX_PREVIEW_SAMPLES = TILE_SIZE / 2 + 1;
+
+// relative depth difference at which a sample's weight falls to 1/e during upsampling.
+static const float PREVIEW_DEPTH_SIGMA = 0.05f;
+
 /**
- * @fn	color RayTracer::traceIndividualRay(const Ray &ray, const IScene &theScene, int recursionLevel) const
+ * @fn	void RayTracer::tracePreviewTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state, const IScene &theScene, int tile, int depth, int aaValue, const std::vector<int> *candidates)
+ * @brief	Traces one tile at reduced resolution and upsamples it. One pixel per
+ * 			previewFactor x previewFactor block is traced, on a grid that also covers
+ * 			the tile's far edges so that tiles do not depend on each other. Each
+ * 			remaining pixel is a joint bilateral blend of the four samples around it,
+ * 			weighted by distance and by how well their depths agree. Pixels whose
+ * 			samples do not all see the same objects lie on an edge, and are traced.
+ * @param [in,out]	frameBuffer	Framebuffer.
+ * @param 		  	view	   	The view.
+ * @param [in,out]	state	   	The view's state.
+ * @param 		  	theScene   	The scene.
+ * @param 		  	tile	   	Index of the tile, in row-major order.
+ * @param 		  	depth	   	The recursion depth.
+ * @param 		  	aaValue	   	1 for no antialiasing, 3 for 9 samples per pixel.
+ * @param 		  	candidates 	The visible objects the primary rays may hit, or nullptr for all of them.
+ */
+
+void RayTracer::tracePreviewTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state,
+									const IScene &theScene, int tile, int depth, int aaValue,
+									const std::vector<int> *candidates) {
+	int numSamples = (aaValue == 3) ? 9 : 1;
+	int f = std::min(state.previewFactor, TILE_SIZE / 2);
+	int x0 = (tile % state.tilesX) * TILE_SIZE;
+	int y0 = (tile / state.tilesX) * TILE_SIZE;
+	int xEnd = std::min(x0 + TILE_SIZE, view.width);
+	int yEnd = std::min(y0 + TILE_SIZE, view.height);
+	int cols = (xEnd - x0 + f - 1) / f + 1;
+	int rows = (yEnd - y0 + f - 1) / f + 1;
+
+	// position of each grid line, clamped to the view
+	int sx[MAX_PREVIEW_SAMPLES], sy[MAX_PREVIEW_SAMPLES];
+	for (int i = 0; i < cols; i++) {
+		sx[i] = std::min(x0 + i * f, view.width - 1);
+	}
+	for (int j = 0; j < rows; j++) {
+		sy[j] = std::min(y0 + j * f, view.height - 1);
+	}
+	PreviewSample samples[MAX_PREVIEW_SAMPLES][MAX_PREVIEW_SAMPLES];
+	for (int j = 0; j < rows; j++) {
+		for (int i = 0; i < cols; i++) {
+			PreviewSample &sample = samples[j][i];
+			int cacheIndex = (sy[j] * view.width + sx[i]) * numSamples;
+			sample.C = tracePixel(*view.camera, state, theScene, sx[i], sy[j], depth, aaValue,
+									cacheIndex, candidates, &sample);
+		}
+	}
+
+	for (int y = y0; y < yEnd; ++y) {
+		int j = std::min((y - y0) / f, rows - 2);
+		float wy = (sy[j + 1] > sy[j]) ? (y - sy[j]) / (float)(sy[j + 1] - sy[j]) : 0.0f;
+		for (int x = x0; x < xEnd; ++x) {
+			int i = std::min((x - x0) / f, cols - 2);
+			float wx = (sx[i + 1] > sx[i]) ? (x - sx[i]) / (float)(sx[i + 1] - sx[i]) : 0.0f;
+			if (x == sx[i] && y == sy[j]) {
+				frameBuffer.setPixel(view.left + x, view.bottom + y, samples[j][i].C, samples[j][i].t);
+				continue;
+			}
+			const PreviewSample *corner[4] = { &samples[j][i], &samples[j][i + 1],
+												&samples[j + 1][i], &samples[j + 1][i + 1] };
+			float spatial[4] = { (1 - wx) * (1 - wy), wx * (1 - wy), (1 - wx) * wy, wx * wy };
+			bool sameObjects = true;
+			float interpT = 0.0f;
+			for (int k = 0; k < 4; k++) {
+				sameObjects = sameObjects && corner[k]->objectIndex == corner[0]->objectIndex &&
+								corner[k]->transIndex == corner[0]->transIndex;
+				interpT += spatial[k] * corner[k]->t;
+			}
+			color C = black;
+			float totalWeight = 0.0f;
+			if (sameObjects) {
+				for (int k = 0; k < 4; k++) {
+					float w = spatial[k];
+					if (corner[0]->objectIndex >= 0) {
+						float dt = (corner[k]->t - interpT) / (PREVIEW_DEPTH_SIGMA * interpT);
+						w *= std::exp(-dt * dt);
+					}
+					C += w * corner[k]->C;
+					totalWeight += w;
+				}
+			}
+			if (totalWeight > EPSILON) {
+				float t = (corner[0]->objectIndex >= 0) ? interpT : FLT_MAX;
+				frameBuffer.setPixel(view.left + x, view.bottom + y, C / totalWeight, t);
+			} else {
+				int cacheIndex = (y * view.width + x) * numSamples;
+				PreviewSample sample;
+				sample.C = tracePixel(*view.camera, state, theScene, x, y, depth, aaValue,
+										cacheIndex, candidates, &sample);
+				frameBuffer.setPixel(view.left + x, view.bottom + y, sample.C, sample.t);
+			}
+		}
+	}
+}
+
+// offsets of the antialiasing samples, in units of EPSILON * 500 pixels.
+static const float AA_OFFSETS[9][2] = { { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, 1 }, { 0, -1 },
+										{ -1, 1 }, { 1, 1 }, { -1, -1 }, { 1, -1 } };
+
+/**
+ * @fn	color RayTracer::tracePixel(const RaytracingCamera &camera, ViewState &state, const IScene &theScene, int x, int y, int depth, int aaValue, int cacheIndex, const std::vector<int> *candidates, PreviewSample *sample)
+ * @brief	Computes the color of one pixel. When relightingCache is on, the primary
+ * 			hits are either recorded into the view's cache or, if the view is re-shaded
+ * 			this frame, read back from it instead of being intersected again.
+ * @param 		  	camera	  	The camera.
+ * @param [in,out]	state	  	The view's state.
+ * @param 		  	theScene  	The scene.
+ * @param 		  	x		  	The x coordinate of the pixel, within the view.
+ * @param 		  	y		  	The y coordinate of the pixel, within the view.
+ * @param 		  	depth	  	The recursion depth.
+ * @param 		  	aaValue   	1 for no antialiasing, 3 for 9 samples per pixel.
+ * @param 		  	cacheIndex	Index of the pixel's first sample in the cache.
+ * @param 		  	candidates	The visible objects the primary rays may hit, or nullptr for all of them.
+ * @param [out]		sample	  	If not null, receives the depth and objects hit by the center ray.
+ * @return	The color of the pixel.
+ */
+
+color RayTracer::tracePixel(const RaytracingCamera &camera, ViewState &state, const IScene &theScene,
+							int x, int y, int depth, int aaValue, int cacheIndex,
+							const std::vector<int> *candidates, PreviewSample *sample) {
+	int numSamples = (aaValue == 3) ? 9 : 1;
+	color total = black;
+	for (int i = 0; i < numSamples; i++) {
+		Ray ray = (i == 0) ? camera.getPixelRay(x, y) :
+						camera.getRay(x + AA_OFFSETS[i][0] * EPSILON * 500,
+										y + AA_OFFSETS[i][1] * EPSILON * 500);
+		HitRecord theHit, transHit;
+		int objectIndex, transIndex;
+		if (state.fromCache) {
+			theHit = state.primaryHits[cacheIndex + i].toHitRecord(theScene.visibleObjects);
+			transHit = state.transparentHits[cacheIndex + i].toHitRecord(theScene.transparentObjects);
+			objectIndex = state.primaryHits[cacheIndex + i].objectIndex;
+			transIndex = state.transparentHits[cacheIndex + i].objectIndex;
+		} else {
+			if (candidates != nullptr) {
+				theHit = VisibleIShape::findIntersection(ray, theScene.visibleObjects, *candidates, objectIndex);
+			} else {
+				theHit = VisibleIShape::findIntersection(ray, theScene.visibleObjects, objectIndex);
+			}
+			transHit = VisibleIShape::findIntersection(ray, theScene.transparentObjects, transIndex);
+			if (state.recordHits) {
+				state.primaryHits[cacheIndex + i] = CachedHit(theHit, objectIndex);
+				state.transparentHits[cacheIndex + i] = CachedHit(transHit, transIndex);
+			}
+		}
+		if (i == 0 && sample != nullptr) {
+			sample->t = (objectIndex >= 0) ? theHit.t : FLT_MAX;
+			sample->objectIndex = objectIndex;
+			sample->transIndex = transIndex;
+		}
+		total += shadeHits(ray, theHit, transHit, theScene, camera.cameraFrame, depth);
+	}
+	return total / (float)numSamples;
+}
+
+/**
+ * @fn	void RayTracer::binObjects(ViewState &state, const RaytracingCamera &camera, const IScene &theScene, int width, int height)
+ * @brief	Builds the list of visible objects that primary rays may hit in each tile.
+ * 			Bounded objects are binned by their projected bounds; objects without bounds,
+ * 			or whose bounds cannot be projected, go into every tile.
+ * @param [in,out]	state   	The view's state.
+ * @param 		  	camera  	The camera.
+ * @param 		  	theScene	The scene.
+ * @param 		  	width   	Width of the view.
+ * @param 		  	height  	Height of the view.
+ */
+
+void RayTracer::binObjects(ViewState &state, const RaytracingCamera &camera, const IScene &theScene,
+							int width, int height) {
+	std::vector<std::vector<int>> &tileObjects = state.tileObjects;
+	int tilesX = state.tilesX;
+	float maxX = (float)(width - 1);
+	float maxY = (float)(height - 1);
+	tileObjects.resize(state.tilesX * state.tilesY);
+	for (unsigned int i = 0; i < tileObjects.size(); i++) {
+		tileObjects[i].clear();
+	}
+	for (unsigned int i = 0; i < theScene.visibleObjects.size(); i++) {
+		BoundingBox3D box(ORIGIN3D, ORIGIN3D);
+		BoundingBoxf windowBox(0, 0, 0, 0);
+		if (!theScene.visibleObjects[i]->shape->getBounds(box) ||
+			!camera.projectBoundsToWindow(box, windowBox)) {
+			for (unsigned int j = 0; j < tileObjects.size(); j++) {
+				tileObjects[j].push_back(i);
+			}
+			continue;
+		}
+		// antialiasing samples reach half a pixel beyond each pixel's center
+		windowBox.lx -= 1.0f;
+		windowBox.rx += 1.0f;
+		windowBox.ly -= 1.0f;
+		windowBox.ry += 1.0f;
+		if (windowBox.rx < 0 || windowBox.lx > maxX || windowBox.ry < 0 || windowBox.ly > maxY) {
+			continue;
+		}
+		int left = (int)std::floor(glm::clamp(windowBox.lx, 0.0f, maxX)) / TILE_SIZE;
+		int right = (int)std::ceil(glm::clamp(windowBox.rx, 0.0f, maxX)) / TILE_SIZE;
+		int bottom = (int)std::floor(glm::clamp(windowBox.ly, 0.0f, maxY)) / TILE_SIZE;
+		int top = (int)std::ceil(glm::clamp(windowBox.ry, 0.0f, maxY)) / TILE_SIZE;
+		for (int ty = bottom; ty <= top; ty++) {
+			for (int tx = left; tx <= right; tx++) {
+				tileObjects[ty * tilesX + tx].push_back(i);
+			}
+		}
+	}
+}
+
+/**
+ * @fn	bool RayTracer::sameGeometry(const ViewState &state, const SceneState &currentState) const
+ * @brief	Determines if the primary hits of a view's previous frame are still valid.
+ * 			Unbounded objects (e.g., planes) are assumed not to move.
+ * @param	state			The view's state.
+ * @param	currentState	State of the scene about to be traced.
+ * @return	True iff the camera, viewport and object bounds are unchanged.
+ */
+
+bool RayTracer::sameGeometry(const ViewState &state, const SceneState &currentState) const {
+	const SceneState &prev = state.previousState;
+	return state.hasPreviousState &&
+			currentState.cameraId == prev.cameraId && currentState.cameraVersion == prev.cameraVersion &&
+			currentState.left == prev.left && currentState.bottom == prev.bottom &&
+			currentState.width == prev.width && currentState.height == prev.height &&
+			currentState.aaValue == prev.aaValue &&
+			currentState.numTransparent == prev.numTransparent &&
+			currentState.isBounded == prev.isBounded && currentState.bounds == prev.bounds;
+}
+
+/**
+ * @fn	bool RayTracer::findDirtyTiles(ViewState &state, const SceneState &currentState, const IScene &theScene) const
+ * @brief	Determines which tiles of a view must be re-traced, given what was traced
+ * 			last frame. Unbounded objects (e.g., planes) are assumed not to move.
+ * @param [in,out]	state			The view's state; its dirtyTiles are filled in.
+ * @param 		  	currentState	State of the scene about to be traced.
+ * @param 		  	theScene		The scene.
+ * @return	False if the changes cannot be localized and the whole view must be traced.
+ */
+
+bool RayTracer::findDirtyTiles(ViewState &state, const SceneState &currentState,
+								const IScene &theScene) const {
+	if (!state.hasPreviousState) {
+		return false;
+	}
+	const SceneState &prev = state.previousState;
+	if (currentState.cameraId != prev.cameraId || currentState.cameraVersion != prev.cameraVersion ||
+		currentState.left != prev.left || currentState.bottom != prev.bottom ||
+		currentState.width != prev.width || currentState.height != prev.height ||
+		currentState.aaValue != prev.aaValue || currentState.depth != prev.depth ||
+		currentState.previewFactor != prev.previewFactor ||
+		currentState.numTransparent != prev.numTransparent ||
+		currentState.isBounded != prev.isBounded || !(currentState.lights == prev.lights) ||
+		!(currentState.materials == prev.materials) || currentState.textures != prev.textures) {
+		return false;
+	}
+	// reflections can carry a change to any part of the frame
+	if (currentState.depth > 0) {
+		return false;
+	}
+	const RaytracingCamera &camera = *currentState.camera;
+	int tilesX = state.tilesX;
+	float maxX = (float)(currentState.width - 1);
+	float maxY = (float)(currentState.height - 1);
+	state.dirtyTiles.assign(state.tilesX * state.tilesY, false);
+	for (unsigned int i = 0; i < currentState.bounds.size(); i++) {
+		if (!currentState.isBounded[i] || currentState.bounds[i] == prev.bounds[i]) {
+			continue;
+		}
+		const BoundingBox3D *boxes[] = { &prev.bounds[i], &currentState.bounds[i] };
+		for (int j = 0; j < 2; j++) {
+			BoundingBoxf windowBox(0, 0, 0, 0);
+			if (!findAffectedWindow(camera, *boxes[j], theScene.lights, windowBox)) {
+				return false;
+			}
+			if (windowBox.rx < 0 || windowBox.lx > maxX || windowBox.ry < 0 || windowBox.ly > maxY) {
+				continue;
+			}
+			int left = (int)std::floor(glm::clamp(windowBox.lx, 0.0f, maxX)) / TILE_SIZE;
+			int right = (int)std::ceil(glm::clamp(windowBox.rx, 0.0f, maxX)) / TILE_SIZE;
+			int bottom = (int)std::floor(glm::clamp(windowBox.ly, 0.0f, maxY)) / TILE_SIZE;
+			int top = (int)std::ceil(glm::clamp(windowBox.ry, 0.0f, maxY)) / TILE_SIZE;
+			for (int ty = bottom; ty <= top; ty++) {
+				for (int tx = left; tx <= right; tx++) {
+					state.dirtyTiles[ty * tilesX + tx] = true;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @fn	bool RayTracer::findAffectedWindow(const RaytracingCamera &camera, const BoundingBox3D &box, const std::vector<PositionalLightPtr> &lights, BoundingBoxf &windowBox) const
+ * @brief	Computes the window rectangle whose pixels could see an object inside
+ * 			the box, or the shadow that object casts.
+ * @param 		  	camera   	The camera.
+ * @param 		  	box		 	The bounds of the object.
+ * @param 		  	lights   	The lights in the scene.
+ * @param [in,out]	windowBox	The (fractional) pixel rectangle that is affected.
+ * @return	False if the affected region cannot be bounded.
+ */
+
+bool RayTracer::findAffectedWindow(const RaytracingCamera &camera, const BoundingBox3D &box,
+									const std::vector<PositionalLightPtr> &lights, BoundingBoxf &windowBox) const {
+	if (!camera.projectBoundsToWindow(box, windowBox)) {
+		return false;
+	}
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		if (!lights[i]->isOn) {
+			continue;
+		}
+		if (box.contains(lights[i]->lightPosition)) {
+			return false;
+		}
+		// the shadow volume lies within the hull of the rays leaving the light through the corners
+		for (int j = 0; j < 8; j++) {
+			glm::vec3 corner = box.getCorner(j);
+			BoundingBoxf rayBox(0, 0, 0, 0);
+			if (!camera.projectRayToWindow(Ray(corner, corner - lights[i]->lightPosition), rayBox)) {
+				return false;
+			}
+			windowBox.lx = std::min(windowBox.lx, rayBox.lx);
+			windowBox.rx = std::max(windowBox.rx, rayBox.rx);
+			windowBox.ly = std::min(windowBox.ly, rayBox.ly);
+			windowBox.ry = std::max(windowBox.ry, rayBox.ry);
+		}
+	}
+	// antialiasing samples reach half a pixel beyond each pixel's center
+	windowBox.lx -= 1.0f;
+	windowBox.rx += 1.0f;
+	windowBox.ly -= 1.0f;
+	windowBox.ry += 1.0f;
+	return true;
+}
+
+/**
+ * @fn	color RayTracer::traceIndividualRay(const Ray &ray, const IScene &theScene, const Frame &eyeFrame, int recursionLevel) const
  * @brief	Trace an individual ray.
  * @param	ray			  	The ray.
  * @param	theScene	  	The scene.
+ * @param	eyeFrame	  	Frame of the camera the ray was traced for.
  * @param	recursionLevel	The recursion level.
  * @return	The color to be displayed as a result of this ray.
  */
@@ -85,72 +1008,200 @@ void RayTracer::raytraceScene(FrameBuffer &frameBuffer, int depth,
 // check if the ray hits anything
 // then check if the hit is between the light and the lightposition (distance(intercept, second intercept) < distance(intercept, lightPos)
 // must change this as well
-color RayTracer::traceIndividualRay(const Ray &ray, const IScene &theScene, int recursionLevel) const {
+color RayTracer::traceIndividualRay(const Ray &ray, const IScene &theScene, const Frame &eyeFrame,
+										int recursionLevel) const {
 	HitRecord theHit = VisibleIShape::findIntersection(ray, theScene.visibleObjects);
 	HitRecord transHit = VisibleIShape::findIntersection(ray, theScene.transparentObjects);
+	return shadeHits(ray, theHit, transHit, theScene, eyeFrame, recursionLevel);
+}
+
+/**
+ * @fn	color RayTracer::shadeHits(const Ray &ray, HitRecord theHit, const HitRecord &transHit, const IScene &theScene, const Frame &eyeFrame, int recursionLevel) const
+ * @brief	Shades the closest opaque and transparent hits of a ray.
+ * @param	ray			  	The ray.
+ * @param	theHit		  	The closest opaque hit.
+ * @param	transHit	  	The closest transparent hit.
+ * @param	theScene	  	The scene.
+ * @param	eyeFrame	  	Frame of the camera the ray was traced for.
+ * @param	recursionLevel	The recursion level.
+ * @return	The color to be displayed as a result of this ray.
+ */
+
+color RayTracer::shadeHits(const Ray &ray, HitRecord theHit, const HitRecord &transHit,
+							const IScene &theScene, const Frame &eyeFrame, int recursionLevel) const {
 	color result = defaultColor;
-	bool inShadow1 = false;
-	bool inShadow2 = false;
 	if (theHit.t < FLT_MAX) {
 		// backsurface rendering
 		if (glm::dot(ray.direction, theHit.surfaceNormal) > 0) {
 			theHit.surfaceNormal = -theHit.surfaceNormal;
 		}
-		if (theScene.lights[0]->isOn) {
-			shadowFeeler(ray, theScene, recursionLevel, inShadow1, theHit, 0);
-		}
-		if (theScene.lights[1]->isOn) {
-			shadowFeeler(ray, theScene, recursionLevel, inShadow2, theHit, 1);
-		}
-		color posColor = posColor = theScene.lights[0]->illuminate(theHit.interceptPoint, theHit.surfaceNormal,
-			theHit.material, theScene.camera->cameraFrame, inShadow1);
-		color spotColor = theScene.lights[1]->illuminate(theHit.interceptPoint, theHit.surfaceNormal,
-			theHit.material, theScene.camera->cameraFrame, inShadow2);
+		color lightColor = illuminateHit(ray, theHit, theScene, eyeFrame, true, recursionLevel);
 		if (theHit.texture != nullptr) {
 			float u = glm::clamp(theHit.u, 0.0f, 1.0f);
 			float v = glm::clamp(theHit.v, 0.0f, 1.0f);//50/50 mapping of texture
-			result = (0.5f) * theHit.texture->getPixel(u, v) + (0.25f) * posColor + (0.25f) * spotColor;
+			result = (0.5f) * theHit.texture->getPixel(u, v) + (0.25f) * lightColor;
 		}
 		else {
-			result = posColor + spotColor;
+			result = lightColor;
 		}
-		if (transHit.t < FLT_MAX) {
-			float opaqueHitDist = glm::distance(theHit.interceptPoint, theScene.lights[0]->lightPosition);
-			float transHitDist = glm::distance(transHit.interceptPoint, theScene.lights[0]->lightPosition);
-			if (opaqueHitDist > transHitDist) {
-				color transHitColor = theScene.lights[0]->illuminate(transHit.interceptPoint,
-					transHit.surfaceNormal, transHit.material, theScene.camera->cameraFrame, false);
-				color transSpotHitColor = theScene.lights[1]->illuminate(transHit.interceptPoint,
-					transHit.surfaceNormal, transHit.material, theScene.camera->cameraFrame, false);
-				color finalColorPos = (1 - transHit.material.alpha) * result + (transHit.material.alpha) * transHitColor;
-				color finalColorSpot = (1 - transHit.material.alpha) * result + (transHit.material.alpha) * transSpotHitColor;
-				result = finalColorPos + finalColorSpot;
-			}
+		if (transHit.t < theHit.t) {
+			// the transparent surface is in front of the opaque one
+			color transHitColor = illuminateHit(ray, transHit, theScene, eyeFrame, false, recursionLevel);
+			result = (1 - transHit.material.alpha) * result + (transHit.material.alpha) * transHitColor;
 		}
 		if (recursionLevel > 0) {
 			glm::vec3 reflectRayOrig = (theHit.interceptPoint + EPSILON * theHit.surfaceNormal);
 			Ray reflectRay(reflectRayOrig, (ray.direction - 2 * glm::dot(ray.direction, theHit.surfaceNormal)*theHit.surfaceNormal));
-			if (!theScene.lights[0]->isOn && !theScene.lights[1]->isOn) {
+			if (!lightTree.anyLightIsOn()) {
 				result = black;
 			}
 			else {
-				result = (0.8f) * result + (0.2f) * traceIndividualRay(reflectRay, theScene, recursionLevel - 1);
+				result = (0.8f) * result + (0.2f) * traceIndividualRay(reflectRay, theScene, eyeFrame, recursionLevel - 1);
 			}
 					
 		}
 	}
 	else if (theHit.t == FLT_MAX && transHit.t < FLT_MAX) {
-		color transHitColor = theScene.lights[0]->illuminate(transHit.interceptPoint,
-			transHit.surfaceNormal, transHit.material, theScene.camera->cameraFrame, inShadow1);
+		color transHitColor = illuminateHit(ray, transHit, theScene, eyeFrame, false, recursionLevel);
 		color finalColor = (1 - transHit.material.alpha) * defaultColor + (transHit.material.alpha) * transHitColor;
 		result = finalColor;
 	}
 	return result;
 }
+
+/**
+ * @fn	color RayTracer::illuminateHit(const Ray &ray, const HitRecord &hit, const IScene &theScene, const Frame &eyeFrame, bool castShadows, int recursionLevel) const
+ * @brief	Sums the colors every light produces at a hit. Lights the hierarchy
+ * 			finds out of reach add only their ambient colors. The nearby lights are
+ * 			gathered into a per-thread buffer, so shading a hit does not allocate.
+ * @param	ray			  	The ray.
+ * @param	hit			  	The hit.
+ * @param	theScene	  	The scene.
+ * @param	eyeFrame	  	Frame of the camera the ray was traced for.
+ * @param	castShadows   	True if shadow feelers are sent to the lights.
+ * @param	recursionLevel	The recursion level.
+ * @return	The summed color.
+ */
+
+color RayTracer::illuminateHit(const Ray &ray, const HitRecord &hit, const IScene &theScene,
+								const Frame &eyeFrame, bool castShadows, int recursionLevel) const {
+	color result = black;
+	const std::vector<int> &globalLights = lightTree.getGlobalLights();
+	for (unsigned int j = 0; j < globalLights.size(); j++) {
+		result += illuminateByLight(ray, hit, theScene, eyeFrame, castShadows, recursionLevel, globalLights[j]);
+	}
+	thread_local std::vector<int> nearLights;
+	lightTree.findLights(hit.interceptPoint, nearLights);
+	result += ambientColor(hit.material.ambient, lightTree.ambientBeyond(nearLights));
+	if (lightSamples > 0 && (int)nearLights.size() > lightSamples) {
+		result += sampleLights(ray, hit, theScene, eyeFrame, castShadows, recursionLevel, nearLights);
+	} else {
+		for (unsigned int j = 0; j < nearLights.size(); j++) {
+			result += illuminateByLight(ray, hit, theScene, eyeFrame, castShadows, recursionLevel, nearLights[j]);
+		}
+	}
+	return result;
+}
+
+/**
+ * @fn	static unsigned int hashPoint(const glm::vec3 &pt)
+ * @brief	Hashes the bits of a point, to seed the light samples taken there. The
+ * 			same point always takes the same samples, so the noise does not crawl
+ * 			from frame to frame.
+ * @param	pt	The point.
+ * @return	The hash.
+ */
+
+static unsigned int hashPoint(const glm::vec3 &pt) {
+	const unsigned char *bytes = (const unsigned char *)&pt[0];
+	unsigned int hash = 2166136261u;
+	for (unsigned int i = 0; i < sizeof(float) * 3; i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @fn	color RayTracer::sampleLights(const Ray &ray, const HitRecord &hit, const IScene &theScene, const Frame &eyeFrame, bool castShadows, int recursionLevel, const std::vector<int> &nearLights) const
+ * @brief	Estimates the summed color of many lights from lightSamples of them.
+ * 			Lights are picked in proportion to their attenuated peak intensity at
+ * 			the hit, and each sample is weighted by the inverse of its probability,
+ * 			so the estimate averages to the full sum.
+ * @param	ray			  	The ray.
+ * @param	hit			  	The hit.
+ * @param	theScene	  	The scene.
+ * @param	eyeFrame	  	Frame of the camera the ray was traced for.
+ * @param	castShadows   	True if shadow feelers are sent to the sampled lights.
+ * @param	recursionLevel	The recursion level.
+ * @param	nearLights	  	The lights to sample.
+ * @return	The estimated color.
+ */
+
+color RayTracer::sampleLights(const Ray &ray, const HitRecord &hit, const IScene &theScene,
+								const Frame &eyeFrame, bool castShadows, int recursionLevel,
+								const std::vector<int> &nearLights) const {
+	thread_local std::vector<float> cumulative;
+	cumulative.resize(nearLights.size());
+	float total = 0.0f;
+	for (unsigned int j = 0; j < nearLights.size(); j++) {
+		const PositionalLight &light = *theScene.lights[nearLights[j]];
+		float distance = glm::distance(hit.interceptPoint, light.lightPosition);
+		total += LightHierarchy::peakIntensity(light) * light.attenuationParams.factor(distance);
+		cumulative[j] = total;
+	}
+	color result = black;
+	if (total <= 0.0f) {
+		for (unsigned int j = 0; j < nearLights.size(); j++) {
+			result += illuminateByLight(ray, hit, theScene, eyeFrame, castShadows, recursionLevel, nearLights[j]);
+		}
+		return result;
+	}
+	unsigned int seed = hashPoint(hit.interceptPoint);
+	for (int k = 0; k < lightSamples; k++) {
+		seed = seed * 1664525u + 1013904223u;
+		float u = (seed >> 8) * (total / 16777216.0f);
+		int j = (int)(std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin());
+		j = std::min(j, (int)nearLights.size() - 1);
+		float probability = (cumulative[j] - (j > 0 ? cumulative[j - 1] : 0.0f)) / total;
+		result += illuminateByLight(ray, hit, theScene, eyeFrame, castShadows, recursionLevel, nearLights[j]) /
+					(lightSamples * probability);
+	}
+	return result;
+}
+
+/**
+ * @fn	color RayTracer::illuminateByLight(const Ray &ray, const HitRecord &hit, const IScene &theScene, const Frame &eyeFrame, bool castShadows, int recursionLevel, int light) const
+ * @brief	Computes the color one light produces at a hit.
+ * @param	ray			  	The ray.
+ * @param	hit			  	The hit.
+ * @param	theScene	  	The scene.
+ * @param	eyeFrame	  	Frame of the camera the ray was traced for.
+ * @param	castShadows   	True if a shadow feeler is sent to the light.
+ * @param	recursionLevel	The recursion level.
+ * @param	light		  	Index of the light.
+ * @return	The color.
+ */
+
+color RayTracer::illuminateByLight(const Ray &ray, const HitRecord &hit, const IScene &theScene,
+									const Frame &eyeFrame, bool castShadows, int recursionLevel, int light) const {
+	bool inShadow = false;
+	if (castShadows) {
+		shadowFeeler(ray, theScene, recursionLevel, inShadow, hit, light);
+	}
+	return theScene.lights[light]->illuminate(hit.interceptPoint, hit.surfaceNormal,
+												hit.material, eyeFrame, inShadow);
+}
+
 void RayTracer::shadowFeeler(const Ray &ray, const IScene &theScene, int recursionLevel, bool &inShadow, HitRecord theHit, int i) const {
 	glm::vec3 shadowFeelerOrig = (theHit.interceptPoint + EPSILON * theHit.surfaceNormal);
 	Ray shadowFeeler(shadowFeelerOrig, pointingVector(shadowFeelerOrig, theScene.lights[i]->lightPosition));
-	HitRecord shadowHit = VisibleIShape::findIntersection(shadowFeeler, theScene.visibleObjects);
+	HitRecord shadowHit;
+	if (i < (int)shadowCasters.size()) {
+		int index;
+		shadowHit = VisibleIShape::findIntersection(shadowFeeler, theScene.visibleObjects, shadowCasters[i], index);
+	} else {
+		shadowHit = VisibleIShape::findIntersection(shadowFeeler, theScene.visibleObjects);
+	}
 	if (shadowHit.t < FLT_MAX) {
 		if(shadowHit.material.alpha == 1.0f){
 			float distToLight = glm::distance(shadowFeeler.origin, theScene.lights[i]->lightPosition);
@@ -4,6 +4,146 @@
 #include "FrameBuffer.h"
 #include "Camera.h"
 #include "IScene.h"
+#include "RenderControl.h"
+#include "LightHierarchy.h"
+
+/**
+ * @struct	RaytracingView
+ * @brief	A camera and the viewport of the frame buffer it renders into.
+ */
+
+struct RaytracingView {
+	RaytracingCamera *camera;	//!< camera for this view
+	int left, bottom;			//!< lower left corner of the viewport in the frame buffer
+	int width, height;			//!< size of the viewport
+	RaytracingView(RaytracingCamera *cam, int L, int B, int W, int H);
+};
+
+/**
+ * @struct	LightState
+ * @brief	Snapshot of the light parameters that affect shading.
+ */
+
+struct LightState {
+	glm::vec3 position;							//!< position of the light
+	bool isOn;									//!< true if the light was on
+	bool attenuationIsTurnedOn;					//!< true if attenuation was active
+	bool isTiedToWorld;							//!< true if the position was in world coordinates
+	LightAttenuationParameters attenuationParams;	//!< attenuation parameters
+	color ambient, diffuse, specular;			//!< light color components
+	glm::vec3 spotDirection;					//!< direction of spotlight (zero for positional lights)
+	float fov;									//!< field of view of spotlight (zero for positional lights)
+	LightState(const PositionalLight &light);
+	bool operator == (const LightState &other) const;
+};
+
+/**
+ * @struct	SceneState
+ * @brief	Snapshot of what was traced into the previous frame. Comparing two of
+ * 			these tells the ray tracer which parts of the frame have to be redone.
+ */
+
+struct SceneState {
+	const RaytracingCamera *camera;		//!< camera used to trace the frame
+	unsigned int cameraId;				//!< id of that camera (copies of a camera share its id)
+	unsigned int cameraVersion;			//!< version of that camera
+	int left, bottom;					//!< lower left corner of the viewport
+	int width, height;					//!< size of the viewport
+	int depth;							//!< recursion depth
+	int aaValue;						//!< antialiasing value
+	int previewFactor;					//!< reduced resolution factor (1 for full resolution)
+	std::vector<LightState> lights;		//!< state of each light
+	std::vector<bool> isBounded;		//!< true if the corresponding object has bounds
+	std::vector<BoundingBox3D> bounds;	//!< bounds of each object (when bounded)
+	std::vector<Material> materials;	//!< material of each object
+	std::vector<Image *> textures;		//!< texture of each object
+	int numTransparent;					//!< number of transparent objects
+	SceneState();
+	SceneState(const IScene &theScene, int depth, int aaValue);
+	void setView(const RaytracingView &view);
+};
+
+/**
+ * @struct	CachedHit
+ * @brief	The part of a primary hit that does not depend on lights or materials.
+ * 			One of these is kept per primary ray so that light and material edits
+ * 			can be re-shaded without intersecting the primary rays again.
+ */
+
+struct CachedHit {
+	float t;					//!< the t value of the hit (FLT_MAX if none)
+	glm::vec3 interceptPoint;	//!< the (x,y,z) value of the hit
+	glm::vec3 surfaceNormal;	//!< the normal vector at the hit
+	int objectIndex;			//!< index of the object that was hit (-1 if none)
+	float u, v;					//!< texture coordinates of the hit
+	CachedHit();
+	CachedHit(const HitRecord &hit, int index);
+	HitRecord toHitRecord(const std::vector<VisibleIShapePtr> &objects) const;
+};
+
+/**
+ * @struct	PreviewSample
+ * @brief	A pixel traced at reduced resolution, with the depth and object that
+ * 			guide the upsampling of the pixels around it.
+ */
+
+struct PreviewSample {
+	color C;			//!< color of the pixel
+	float t;			//!< t value of the opaque hit of the center ray (FLT_MAX if none)
+	int objectIndex;	//!< opaque object hit by the center ray (-1 if none)
+	int transIndex;		//!< transparent object hit by the center ray (-1 if none)
+};
+
+/**
+ * @struct	ViewState
+ * @brief	Everything the ray tracer keeps for one view between frames, plus the
+ * 			plan for the frame currently being traced.
+ */
+
+struct ViewState {
+	bool hasPreviousState;					//!< true if previousState holds a traced frame
+	SceneState previousState;				//!< what was traced into the previous frame
+	bool cacheIsValid;						//!< true if the cached hits match previousState
+	std::vector<CachedHit> primaryHits;		//!< opaque hit of each primary ray
+	std::vector<CachedHit> transparentHits;	//!< transparent hit of each primary ray
+	std::vector<std::vector<int>> tileObjects;	//!< indices of the objects that may be seen in each tile
+	int tilesX, tilesY;						//!< number of tile columns and rows this frame
+	std::vector<bool> dirtyTiles;			//!< true for each tile that is traced this frame
+	bool fromCache;							//!< true if this frame is re-shaded from the cached hits
+	bool recordHits;						//!< true if this frame's primary hits are cached
+	bool useTileObjects;					//!< true if this frame's primary rays use tileObjects
+	int previewFactor;						//!< this frame's reduced resolution factor
+	bool keepHistory;						//!< true if this frame is recorded for the next one to reproject
+	bool checkerboard;						//!< true if this frame traces half of the pixels
+	int parity;								//!< which half of the pixels a checkerboard frame traces
+	bool hasHistory;						//!< true if the previous frame was recorded
+	std::vector<color> previousColors;		//!< colors of the previous frame
+	std::vector<float> previousDepths;		//!< t values of the previous frame
+	std::vector<color> currentColors;		//!< colors of this frame
+	std::vector<float> currentDepths;		//!< t values of this frame
+	std::shared_ptr<RaytracingCamera> previousCamera;	//!< camera of the previous frame
+	std::shared_ptr<RaytracingCamera> currentCamera;	//!< camera of this frame
+	ViewState();
+};
+
+/**
+ * @struct	TracingOptions
+ * @brief	The optional optimizations of a ray tracer. RenderService traces each
+ * 			frame with the copy passed to requestFrame, so the application may
+ * 			change its own copy while a frame is traced.
+ */
+
+struct TracingOptions {
+	bool dirtyRegionTracing;	//!< true if only the tiles affected by changes are re-traced
+	bool relightingCache;		//!< true if light and material edits re-shade cached primary hits
+	bool tileObjectLists;		//!< true if primary rays only test the objects binned to their tile
+	int previewFactor;			//!< 1 traces every pixel; 2 or 4 traces one pixel per 2x2 or 4x4 block and upsamples
+	bool checkerboardRendering;	//!< true if each frame traces half the pixels and reprojects the rest
+	bool shadowCasterLists;		//!< true if shadow feelers only test the objects that may shadow their light
+	bool lightHierarchy;		//!< true if shading points only evaluate the lights that reach them
+	int sampledLights;			//!< if positive, points reached by more lights sample this many of them
+	TracingOptions();
+};
 
 /**
  * @struct	RayTracer
@@ -12,10 +152,59 @@
 
 struct RayTracer {
 	color defaultColor;
+	TracingOptions options;		//!< the optimizations to use; changed only between frames
 	RayTracer(const color &defaultColor);
 	void raytraceScene(FrameBuffer &frameBuffer, int depth,
-						const IScene &theScene, int aaVal) const;
+						const IScene &theScene, int aaVal);
+	bool raytraceViews(FrameBuffer &frameBuffer, int depth, const IScene &theScene,
+						int aaVal, const std::vector<RaytracingView> &views,
+						const RenderControl *control = nullptr, std::vector<int> *completedTiles = nullptr);
+	int beginFrame(const IScene &theScene, int depth, int aaVal,
+					const std::vector<RaytracingView> &views);
+	void traceInterleavedTile(FrameBuffer &frameBuffer, const IScene &theScene, int tile,
+					int depth, int aaVal, const std::vector<RaytracingView> &views);
+	void invalidateViews();
 	void shadowFeeler(const Ray &ray, const IScene &theScene, int recursionLevel, bool &inShadow, HitRecord theHit, int i) const;
 protected:
-	color traceIndividualRay(const Ray &ray, const IScene &theScene, int recursionLevel) const;
+	std::vector<ViewState> viewStates;	//!< state kept for each view
+	std::vector<std::vector<int>> shadowCasters;	//!< indices of the objects that may shadow each light this frame
+	LightHierarchy lightTree;			//!< the lights of this frame, by where they reach
+	int lightSamples;					//!< sampledLights, latched for this frame
+	color traceIndividualRay(const Ray &ray, const IScene &theScene, const Frame &eyeFrame,
+							int recursionLevel) const;
+	color shadeHits(const Ray &ray, HitRecord theHit, const HitRecord &transHit,
+					const IScene &theScene, const Frame &eyeFrame, int recursionLevel) const;
+	color illuminateHit(const Ray &ray, const HitRecord &hit, const IScene &theScene,
+					const Frame &eyeFrame, bool castShadows, int recursionLevel) const;
+	color sampleLights(const Ray &ray, const HitRecord &hit, const IScene &theScene,
+					const Frame &eyeFrame, bool castShadows, int recursionLevel,
+					const std::vector<int> &nearLights) const;
+	color illuminateByLight(const Ray &ray, const HitRecord &hit, const IScene &theScene,
+					const Frame &eyeFrame, bool castShadows, int recursionLevel, int light) const;
+	void planView(const RaytracingView &view, ViewState &state, const SceneState &frameState,
+					const IScene &theScene);
+	void findShadowCasters(const IScene &theScene, const std::vector<RaytracingView> &views);
+	void planHistory(const RaytracingView &view, ViewState &state, const SceneState &currentState) const;
+	void traceTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state,
+					const IScene &theScene, int tile, int depth, int aaValue);
+	void tracePreviewTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state,
+					const IScene &theScene, int tile, int depth, int aaValue,
+					const std::vector<int> *candidates);
+	void traceCheckerboardTile(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state,
+					const IScene &theScene, int tile, int depth, int aaValue,
+					const std::vector<int> *candidates);
+	bool reprojectPixel(const RaytracingView &view, const ViewState &state, int x, int y,
+					float t, color &C) const;
+	void setViewPixel(FrameBuffer &frameBuffer, const RaytracingView &view, ViewState &state,
+					int x, int y, const color &C, float t) const;
+	color tracePixel(const RaytracingCamera &camera, ViewState &state, const IScene &theScene,
+					int x, int y, int depth, int aaValue, int cacheIndex,
+					const std::vector<int> *candidates, PreviewSample *sample = nullptr);
+	void binObjects(ViewState &state, const RaytracingCamera &camera, const IScene &theScene,
+					int width, int height);
+	bool sameGeometry(const ViewState &state, const SceneState &currentState) const;
+	bool findDirtyTiles(ViewState &state, const SceneState &currentState,
+						const IScene &theScene) const;
+	bool findAffectedWindow(const RaytracingCamera &camera, const BoundingBox3D &box,
+						const std::vector<PositionalLightPtr> &lights, BoundingBoxf &windowBox) const;
 };
@@ -0,0 +1,55 @@
+#include "RenderControl.h"
+
+/**
+ * @fn	RenderControl::RenderControl()
+ * @brief	Constructs a control that is not cancelled and has no deadline.
+ */
+
+RenderControl::RenderControl() : cancelled(false), hasDeadline(false) {
+}
+
+/**
+ * @fn	void RenderControl::reset()
+ * @brief	Clears the cancellation and the deadline, ready for a new frame.
+ * 			Must not be called while a frame is being rendered.
+ */
+
+void RenderControl::reset() {
+	cancelled = false;
+	hasDeadline = false;
+}
+
+/**
+ * @fn	void RenderControl::cancel()
+ * @brief	Asks the frame to stop. May be called from any thread.
+ */
+
+void RenderControl::cancel() {
+	cancelled = true;
+}
+
+/**
+ * @fn	void RenderControl::setDeadline(float seconds)
+ * @brief	Sets the time the frame must stop by. Must not be called while a frame
+ * 			is being rendered.
+ * @param	seconds	Seconds from now; zero or less for no deadline.
+ */
+
+void RenderControl::setDeadline(float seconds) {
+	hasDeadline = seconds > 0.0f;
+	if (hasDeadline) {
+		deadline = std::chrono::steady_clock::now() +
+					std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<float>(seconds));
+	}
+}
+
+/**
+ * @fn	bool RenderControl::shouldStop() const
+ * @brief	Determines if the frame should stop.
+ * @return	True iff the frame was cancelled or its deadline has passed.
+ */
+
+bool RenderControl::shouldStop() const {
+	return cancelled || (hasDeadline && std::chrono::steady_clock::now() >= deadline);
+}
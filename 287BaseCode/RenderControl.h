@@ -0,0 +1,23 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+/**
+ * @struct	RenderControl
+ * @brief	Lets a frame be abandoned part way through. The render loops poll
+ * 			shouldStop between units of work (tiles, triangles), so a cancelled
+ * 			or overdue frame stops within one unit.
+ */
+
+struct RenderControl {
+	RenderControl();
+	void reset();
+	void cancel();
+	void setDeadline(float seconds);
+	bool isCancelled() const { return cancelled; }
+	bool shouldStop() const;
+protected:
+	std::atomic<bool> cancelled;					//!< true once the frame is cancelled
+	bool hasDeadline;								//!< true if the frame has a deadline
+	std::chrono::steady_clock::time_point deadline;	//!< time by which the frame must stop
+};
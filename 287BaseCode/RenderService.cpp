@@ -0,0 +1,322 @@
+#include "RenderService.h"
+
+/**
+ * @fn	RenderFrame::RenderFrame()
+ * @brief	Constructs an empty frame.
+ */
+
+RenderFrame::RenderFrame()
+	: number(0), snapshot(nullptr), width(0), height(0), timeLimit(0.0f), numTiles(0), tilesPublished(0) {
+}
+
+/**
+ * @fn	RenderFrame::~RenderFrame()
+ * @brief	Frees the snapshot of the scene. The camera copies are released, and
+ * 			deleted once no other frame or the service holds them.
+ */
+
+RenderFrame::~RenderFrame() {
+	if (snapshot == nullptr) {
+		return;
+	}
+	for (unsigned int i = 0; i < snapshot->lights.size(); i++) {
+		delete snapshot->lights[i];
+	}
+	for (unsigned int i = 0; i < snapshot->visibleObjects.size(); i++) {
+		delete snapshot->visibleObjects[i]->shape;
+		delete snapshot->visibleObjects[i];
+	}
+	for (unsigned int i = 0; i < snapshot->transparentObjects.size(); i++) {
+		delete snapshot->transparentObjects[i]->shape;
+		delete snapshot->transparentObjects[i];
+	}
+	delete snapshot;
+}
+
+/**
+ * @fn	bool RenderFrame::allTilesDone() const
+ * @brief	Determines if the workers have traced every tile of the frame.
+ * @return	True iff every tile is done.
+ */
+
+bool RenderFrame::allTilesDone() const {
+	for (int i = 0; i < numTiles; i++) {
+		if (!tileDone[i].load(std::memory_order_acquire)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @fn	RenderService::RenderService(RayTracer &tracer)
+ * @brief	Constructs the service and starts its frame thread and worker pool.
+ * @param [in,out]	tracer	The ray tracer used to trace the frames.
+ */
+
+RenderService::RenderService(RayTracer &tracer)
+	: rayTracer(tracer), tracers((int)std::thread::hardware_concurrency() - 2),	// the frame thread traces too; leave a core for GLUT
+	backBuffer(WINDOW_WIDTH, WINDOW_HEIGHT), pending(nullptr), current(nullptr),
+	frameNumber(0), shuttingDown(false), frameTime(0.0f) {
+	frameThread = std::thread(&RenderService::frameLoop, this);
+}
+
+/**
+ * @fn	RenderService::~RenderService()
+ * @brief	Abandons the frame in progress and stops the frame thread.
+ */
+
+RenderService::~RenderService() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		control.cancel();
+		shuttingDown = true;
+	}
+	frameRequested.notify_all();
+	frameThread.join();
+	delete pending;
+	delete current;
+}
+
+/**
+ * @fn	void RenderService::requestFrame(const IScene &theScene, const std::vector<RaytracingView> &views, int width, int height, const QualityLevel &quality, const TracingOptions &options, float timeLimit)
+ * @brief	Requests a new frame, abandoning the one in progress, if any.
+ * 			Returns as soon as the scene has been copied, without waiting for
+ * 			the old frame. The old frame stops after the tiles already being
+ * 			traced, and a request that was never started is dropped.
+ * @param	theScene	The scene.
+ * @param	views   	The views to render, at the traced size. Their cameras are copied.
+ * @param	width   	Width of the traced image. It is scaled to the size of the
+ * 						frame buffer it is published to.
+ * @param	height  	Height of the traced image.
+ * @param	quality 	The quality to trace at. Its resolution scale is informational;
+ * 						the views and size must already be scaled.
+ * @param	options 	The tracer's options for the frame. They are copied, and set on
+ * 						the tracer by the frame thread, so the caller may keep changing its own.
+ * @param	timeLimit	Seconds the frame may take before the workers stop; zero for no limit.
+ */
+
+void RenderService::requestFrame(const IScene &theScene, const std::vector<RaytracingView> &views,
+									int width, int height, const QualityLevel &quality, const TracingOptions &options,
+									float timeLimit) {
+	RenderFrame *frame = new RenderFrame();
+	takeSnapshot(theScene, *frame);
+	frame->views = views;
+	for (unsigned int v = 0; v < frame->views.size(); v++) {
+		frame->cameras.push_back(copyCamera(views[v].camera));
+		frame->views[v].camera = frame->cameras.back().get();
+	}
+	frame->width = width;
+	frame->height = height;
+	frame->quality = quality;
+	frame->options = options;
+	frame->timeLimit = timeLimit;
+
+	RenderFrame *dropped;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		control.cancel();
+		dropped = pending;
+		pending = frame;
+		frame->number = ++frameNumber;
+	}
+	frameRequested.notify_all();
+	delete dropped;
+}
+
+/**
+ * @fn	bool RenderService::publish(FrameBuffer &frameBuffer)
+ * @brief	Copies the tiles of the newest frame finished since the last call into
+ * 			a frame buffer, scaling them if the frame was traced at reduced
+ * 			resolution. Must be called from the thread that requests the frames.
+ * @param [in,out]	frameBuffer	The displayed frame buffer.
+ * @return	True iff this call copied the last tile of the frame.
+ */
+
+bool RenderService::publish(FrameBuffer &frameBuffer) {
+	std::lock_guard<std::mutex> guard(lock);
+	RenderFrame *frame = current;
+	if (frame == nullptr || frame->number != frameNumber || frame->tilesPublished == frame->numTiles) {
+		return false;
+	}
+	for (int tile = 0; tile < frame->numTiles; tile++) {
+		if (frame->tilePublished[tile] || !frame->tileDone[tile].load(std::memory_order_acquire)) {
+			continue;
+		}
+		for (unsigned int v = 0; v < frame->views.size(); v++) {
+			const RaytracingView &view = frame->views[v];
+			int tilesX = (view.width + TILE_SIZE - 1) / TILE_SIZE;
+			int tilesY = (view.height + TILE_SIZE - 1) / TILE_SIZE;
+			if (tile < tilesX * tilesY) {
+				int x = (tile % tilesX) * TILE_SIZE;
+				int y = (tile / tilesX) * TILE_SIZE;
+				frameBuffer.copyPixels(backBuffer, view.left + x, view.bottom + y,
+										std::min(TILE_SIZE, view.width - x),
+										std::min(TILE_SIZE, view.height - y));
+			}
+		}
+		frame->tilePublished[tile] = true;
+		frame->tilesPublished++;
+	}
+	if (frame->tilesPublished != frame->numTiles) {
+		return false;
+	}
+	std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - frame->start;
+	frameTime = elapsed.count();
+	frameQuality = frame->quality;
+	return true;
+}
+
+/**
+ * @fn	bool RenderService::frameIsComplete() const
+ * @brief	Determines if the newest requested frame has been traced and published.
+ * @return	True iff every tile of the newest frame is published, or no frame was requested.
+ */
+
+bool RenderService::frameIsComplete() const {
+	std::lock_guard<std::mutex> guard(lock);
+	if (frameNumber == 0) {
+		return true;
+	}
+	return current != nullptr && current->number == frameNumber &&
+			current->tilesPublished == current->numTiles;
+}
+
+/**
+ * @fn	std::vector<int> RenderService::getCompletedTiles() const
+ * @brief	Lists the interleaved tiles of the current frame that the workers have
+ * 			finished. When a frame was stopped by its deadline, these are the tiles
+ * 			that hold the new image.
+ * @return	The tile numbers, in increasing order.
+ */
+
+std::vector<int> RenderService::getCompletedTiles() const {
+	std::lock_guard<std::mutex> guard(lock);
+	std::vector<int> tiles;
+	if (current == nullptr) {
+		return tiles;
+	}
+	for (int i = 0; i < current->numTiles; i++) {
+		if (current->tileDone[i].load(std::memory_order_acquire)) {
+			tiles.push_back(i);
+		}
+	}
+	return tiles;
+}
+
+/**
+ * @fn	void RenderService::frameLoop()
+ * @brief	Body of the frame thread. Waits for a request, retires the previous
+ * 			frame and traces the new one on the worker pool.
+ */
+
+void RenderService::frameLoop() {
+	bool lastFrameFinished = true;
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		frameRequested.wait(guard, [this] { return shuttingDown || pending != nullptr; });
+		if (shuttingDown) {
+			return;
+		}
+		RenderFrame *frame = pending;
+		RenderFrame *retired = current;
+		pending = nullptr;
+		current = nullptr;		// publish must not read the back buffer while it is set up
+		control.reset();
+		control.setDeadline(frame->timeLimit);
+		guard.unlock();
+
+		delete retired;
+		// what an abandoned frame left behind cannot be used to trace the next one
+		traceFrame(*frame, !lastFrameFinished);
+		lastFrameFinished = frame->allTilesDone();
+		guard.lock();
+	}
+}
+
+/**
+ * @fn	void RenderService::traceFrame(RenderFrame &frame, bool invalidate)
+ * @brief	Sets up a frame, makes it the current frame and traces its tiles on
+ * 			the worker pool until none are left or the frame is cancelled.
+ * 			Called on the frame thread only, which alone uses the tracer.
+ * @param [in,out]	frame	  	The frame.
+ * @param 		  	invalidate	True if the tracer's view state must be discarded.
+ */
+
+void RenderService::traceFrame(RenderFrame &frame, bool invalidate) {
+	rayTracer.options = frame.options;
+	if (invalidate) {
+		rayTracer.invalidateViews();
+	}
+	if (backBuffer.getWindowWidth() != frame.width || backBuffer.getWindowHeight() != frame.height) {
+		backBuffer.setFrameBufferSize(frame.width, frame.height);
+		rayTracer.invalidateViews();
+	}
+	frame.numTiles = rayTracer.beginFrame(*frame.snapshot, frame.quality.depth, frame.quality.aaValue, frame.views);
+	frame.tileDone.reset(new std::atomic<bool>[frame.numTiles]);
+	for (int i = 0; i < frame.numTiles; i++) {
+		frame.tileDone[i] = false;
+	}
+	frame.tilePublished.assign(frame.numTiles, false);
+	frame.start = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		current = &frame;
+	}
+
+	tracers.run(frame.numTiles, [&](int tile) {
+		if (control.shouldStop()) {
+			return;
+		}
+		rayTracer.traceInterleavedTile(backBuffer, *frame.snapshot, tile, frame.quality.depth,
+										frame.quality.aaValue, frame.views);
+		frame.tileDone[tile].store(true, std::memory_order_release);
+	});
+}
+
+/**
+ * @fn	std::shared_ptr<RaytracingCamera> RenderService::copyCamera(const RaytracingCamera *camera)
+ * @brief	Gets the service's copy of an application camera. The copy is kept
+ * 			between frames while the camera is unchanged, so that its ray cache
+ * 			survives. A replaced copy lives on while a frame still traces it.
+ * @param	camera	The application camera.
+ * @return	The copy.
+ */
+
+std::shared_ptr<RaytracingCamera> RenderService::copyCamera(const RaytracingCamera *camera) {
+	std::shared_ptr<RaytracingCamera> &copy = cameraCopies[camera];
+	if (copy == nullptr || copy->version != camera->version) {
+		copy.reset(camera->clone());
+	}
+	return copy;
+}
+
+/**
+ * @fn	void RenderService::takeSnapshot(const IScene &theScene, RenderFrame &frame)
+ * @brief	Gives a frame a copy of a scene's lights, objects and camera.
+ * 			Textures are shared, since the application does not modify them.
+ * @param 		  	theScene	The scene.
+ * @param [in,out]	frame   	The frame.
+ */
+
+void RenderService::takeSnapshot(const IScene &theScene, RenderFrame &frame) {
+	RaytracingCamera *camera = nullptr;
+	if (theScene.camera != nullptr) {
+		frame.cameras.push_back(copyCamera(theScene.camera));
+		camera = frame.cameras.back().get();
+	}
+	frame.snapshot = new IScene(camera, false);
+	for (unsigned int i = 0; i < theScene.lights.size(); i++) {
+		frame.snapshot->addObject(theScene.lights[i]->clone());
+	}
+	for (unsigned int i = 0; i < theScene.visibleObjects.size(); i++) {
+		VisibleIShapePtr obj = new VisibleIShape(*theScene.visibleObjects[i]);
+		obj->shape = obj->shape->clone();
+		frame.snapshot->addObject(obj);
+	}
+	for (unsigned int i = 0; i < theScene.transparentObjects.size(); i++) {
+		VisibleIShapePtr obj = new VisibleIShape(*theScene.transparentObjects[i]);
+		obj->shape = obj->shape->clone();
+		frame.snapshot->transparentObjects.push_back(obj);
+	}
+}
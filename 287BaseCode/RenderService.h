@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include "FrameBuffer.h"
+#include "Raytracer.h"
+#include "IScene.h"
+#include "RenderControl.h"
+#include "QualityController.h"
+#include "WorkerPool.h"
+
+/**
+ * @struct	RenderFrame
+ * @brief	A requested frame: the snapshot of the scene and cameras it traces,
+ * 			and which of its interleaved tiles are done and published.
+ */
+
+struct RenderFrame {
+	RenderFrame();
+	~RenderFrame();
+	bool allTilesDone() const;
+	unsigned int number;						//!< request number of the frame
+	IScene *snapshot;							//!< copy of the scene being traced
+	std::vector<RaytracingView> views;			//!< views being traced, using the camera copies
+	std::vector<std::shared_ptr<RaytracingCamera>> cameras;	//!< keeps the camera copies alive while traced
+	int width, height;							//!< size of the traced image
+	QualityLevel quality;						//!< quality the frame is traced at
+	TracingOptions options;						//!< the tracer's options for the frame
+	float timeLimit;							//!< seconds the frame may take; zero for no limit
+	int numTiles;								//!< number of interleaved tiles in the frame
+	std::unique_ptr<std::atomic<bool>[]> tileDone;	//!< true for each tile the workers have finished
+	std::vector<bool> tilePublished;			//!< true for each tile copied by publish
+	int tilesPublished;							//!< number of tiles copied by publish
+	std::chrono::steady_clock::time_point start;	//!< when tracing started
+};
+
+/**
+ * @struct	RenderService
+ * @brief	Ray traces frames on a worker pool, so that the GLUT main loop never
+ * 			waits for a frame. Each request snapshots the scene and cameras, so the
+ * 			application may keep editing them while the frame is traced. A new
+ * 			request cancels the frame in progress; a frame thread starts the newest
+ * 			request once the old frame's tiles in flight are done. Completed tiles
+ * 			are copied to the displayed frame buffer by publish.
+ */
+
+struct RenderService {
+	RenderService(RayTracer &tracer);
+	~RenderService();
+	void requestFrame(const IScene &theScene, const std::vector<RaytracingView> &views,
+						int width, int height, const QualityLevel &quality, const TracingOptions &options,
+						float timeLimit = 0.0f);
+	bool publish(FrameBuffer &frameBuffer);
+	std::vector<int> getCompletedTiles() const;
+	bool frameIsComplete() const;
+	float lastFrameTime() const { return frameTime; }
+	const QualityLevel &getFrameQuality() const { return frameQuality; }
+protected:
+	RayTracer &rayTracer;						//!< traces the tiles
+	WorkerPool tracers;							//!< threads that trace the tiles, with the frame thread
+	FrameBuffer backBuffer;						//!< frame buffer the workers trace into
+	std::map<const RaytracingCamera *, std::shared_ptr<RaytracingCamera>> cameraCopies;	//!< copy of each application camera
+	std::thread frameThread;					//!< sets up each frame and runs its tiles on the pool
+	mutable std::mutex lock;					//!< guards the fields below
+	std::condition_variable frameRequested;		//!< signaled when a frame is requested
+	RenderFrame *pending;						//!< newest request, not yet started
+	RenderFrame *current;						//!< frame being traced or published
+	unsigned int frameNumber;					//!< incremented for each requested frame
+	bool shuttingDown;							//!< true when the frame thread should exit
+	RenderControl control;						//!< cancellation and deadline of the frame in progress
+	QualityLevel frameQuality;					//!< quality of the last published frame
+	float frameTime;							//!< seconds taken by the last published frame
+	void frameLoop();
+	void traceFrame(RenderFrame &frame, bool invalidate);
+	std::shared_ptr<RaytracingCamera> copyCamera(const RaytracingCamera *camera);
+	void takeSnapshot(const IScene &theScene, RenderFrame &frame);
+};
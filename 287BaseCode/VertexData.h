@@ -11,12 +11,14 @@ struct VertexData {
 	glm::vec4 position;		//!< Processed coordinate.
 	glm::vec3 normal;		//!< transformed normal vector.
 	glm::vec3 worldPosition;//!< Saved world position, for lighting calculations.
-	Material material;		//!< This vertex's material.
+	int material;			//!< This vertex's material, as an index into the MaterialTable.
 
 	VertexData(const glm::vec4 &pos = ORIGIN3DHOMO,
 				const glm::vec3 &norm = glm::vec3(0.0, 0.0, 1.0),
 				const Material &mat = bronze,
 				const glm::vec3 &worldPos = ORIGIN3D);
+	VertexData(const glm::vec4 &pos, const glm::vec3 &norm,
+				int materialIndex, const glm::vec3 &worldPos = ORIGIN3D);
 	VertexData(float w1, const VertexData &vd1,
 				float w2, const VertexData &vd2);
 	static void addTriVertsAndComputeNormal(std::vector<VertexData> &verts,
@@ -37,6 +39,28 @@ struct VertexData {
 		const glm::vec4 &p3, const glm::vec4 &p4,
 		const Material &mat);
 	VertexData operator + (const VertexData &other) const;
+	bool operator == (const VertexData &other) const;
 };
 
 VertexData operator * (float w, const VertexData &V1);
+
+/**
+ * @struct	IndexedMesh
+ * @brief	Triangles that share vertices. Each distinct vertex is stored once, and
+ * 			each successive triplet of indices is a triangle, so the pipeline
+ * 			transforms a shared vertex once rather than once per triangle.
+ * 			Call changed() after modifying the vertices or indices, so that the
+ * 			pipeline does not reuse what it computed from the old ones.
+ */
+
+struct IndexedMesh {
+	std::vector<VertexData> vertices;	//!< the distinct vertices
+	std::vector<unsigned int> indices;	//!< three per triangle, into vertices
+	unsigned int version;				//!< differs between any two states of any meshes
+	IndexedMesh();
+	explicit IndexedMesh(const std::vector<VertexData> &triangleVerts);
+	unsigned int numTriangles() const { return (unsigned int)indices.size() / 3; }
+	void changed();
+protected:
+	static unsigned int lastVersion;	//!< the version last given out
+};
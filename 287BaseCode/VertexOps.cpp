@@ -6,6 +6,11 @@ glm::mat4 VertexOps::viewingTransformation;
 glm::mat4 VertexOps::projectionTransformation;
 glm::mat4 VertexOps::viewportTransformation;
 bool VertexOps::renderBackFaces = true;
+const RenderControl *VertexOps::renderControl = nullptr;
+WorkerPool *VertexOps::rasterPool = nullptr;
+bool VertexOps::cacheTransformedMeshes = true;
+std::unordered_map<const IndexedMesh *, TransformedMesh> VertexOps::transformedMeshes;
+unsigned int VertexOps::frameNumber = 0;
 
 const BoundingBox3D VertexOps::ndc(-1, 1, -1, 1, -1, 1);	//l,r,b,t,n,f
 BoundingBoxi VertexOps::viewport(0, WINDOW_WIDTH - 1, 0, WINDOW_HEIGHT - 1);
@@ -18,85 +23,138 @@ std::vector<IPlane> VertexOps::ndcPlanes{ IPlane(glm::vec3(0, 1, 0), glm::vec3(0
 											IPlane(glm::vec3(0, -1, 0), glm::vec3(0, 1, 0)),
 											IPlane(glm::vec3(0, 0, -1), glm::vec3(0, 0, 1)) };
 
+// the planes of the view volume in clip coordinates, -w <= x, y, z <= w, each
+// with a bit in a vertex's outcode.
+static const int NUM_CLIP_PLANES = 6;
+
+// clipping a triangle against each plane adds at most one vertex.
+static const int MAX_CLIPPED_VERTICES = 3 + NUM_CLIP_PLANES;
+
 /**
- * @fn	std::vector<VertexData> triangulate(const std::vector<VertexData> &poly)
- * @brief	Triangulates the given polygon
- * @param	poly	The polygon to be decomposed into individual triangles.
- * @return	A vector of triangles, which comprise the original polygon.
+ * @fn	static float clipDistance(const glm::vec4 &p, int plane)
+ * @brief	Evaluates the equation of a plane of the view volume at a point in clip
+ * 			coordinates. It is linear along a segment, so where a segment crosses
+ * 			the plane follows from its values at the segment's endpoints.
+ * @param	p	 	The point.
+ * @param	plane	The plane's outcode bit number.
+ * @return	A value that is negative iff the point is outside the plane.
  */
 
-std::vector<VertexData> triangulate(const std::vector<VertexData> &poly) {
-	std::vector<VertexData> triangles;
-
-	for (unsigned int i = 1; i < poly.size() - 1; i++) {
-		triangles.push_back(poly[0]);
-		triangles.push_back(poly[i]);
-		triangles.push_back(poly[i + 1]);
+static float clipDistance(const glm::vec4 &p, int plane) {
+	switch (plane) {
+	case 0:		return p.w + p.x;
+	case 1:		return p.w - p.x;
+	case 2:		return p.w + p.y;
+	case 3:		return p.w - p.y;
+	case 4:		return p.w + p.z;
+	default:	return p.w - p.z;
 	}
+}
+
+/**
+ * @fn	static int outcode(const glm::vec4 &p)
+ * @brief	Computes which planes of the view volume a point is outside of.
+ * @param	p	The point, in clip coordinates.
+ * @return	A bit per plane, set where the point is outside the plane.
+ */
 
-	return triangles;
+static int outcode(const glm::vec4 &p) {
+	return (p.w + p.x < 0 ? 1 : 0) | (p.w - p.x < 0 ? 2 : 0) |
+			(p.w + p.y < 0 ? 4 : 0) | (p.w - p.y < 0 ? 8 : 0) |
+			(p.w + p.z < 0 ? 16 : 0) | (p.w - p.z < 0 ? 32 : 0);
 }
 
 /**
- * @fn	std::vector<VertexData> VertexOps::clipAgainstPlane(std::vector<VertexData> &verts, const IPlane &plane)
- * @brief	Clips a polygon against a single plane
- * @param [in,out]	verts	The array of vertices.
- * @param 		  	plane	The plane that will do the clipping.
- * @return	The polygon that exludes the portions outside the given plane.
+ * @fn	static void addDividedVertex(std::vector<VertexData> &ndcCoords, const VertexData &v)
+ * @brief	Adds a vertex to a list, after the perspective division.
+ * @param [in,out]	ndcCoords	The list, in normalized device coordinates.
+ * @param 		  	v		 	The vertex, in clip coordinates.
  */
 
-std::vector<VertexData> VertexOps::clipAgainstPlane(std::vector<VertexData> &verts, const IPlane &plane) {
-	std::vector<VertexData> output;
-
-	if (verts.size() > 2) {
-		verts.push_back(verts[0]);
-
-		for (unsigned int i = 1; i < verts.size(); i++) {
-			bool v0In = plane.insidePlane(verts[i - 1].position.xyz);
-			bool v1In = plane.insidePlane(verts[i].position.xyz);
-
-			if (v0In && v1In) {
-				output.push_back(verts[i]);
-			} else if (v0In || v1In) {
-				float t;
-				plane.findIntersection(verts[i - 1].position.xyz, verts[i].position.xyz, t);
-				VertexData I(1.0f - t, verts[i - 1], t, verts[i]);
-				output.push_back(I);
-				if (!v0In && v1In) {
-					output.push_back(verts[i]);
-				}
+static void addDividedVertex(std::vector<VertexData> &ndcCoords, const VertexData &v) {
+	ndcCoords.push_back(v);
+	ndcCoords.back().position /= v.position.w;
+}
+
+/**
+ * @fn	static const VertexData *clipToViewVolume(const VertexData *triangle, int planes, VertexData polygons[2][MAX_CLIPPED_VERTICES], int &count)
+ * @brief	Clips a triangle against planes of the view volume in clip coordinates,
+ * 			a plane at a time (Sutherland-Hodgman). The polygon left after each
+ * 			plane goes into the other of two fixed buffers.
+ * @param 		  	triangle	The triangle's vertices.
+ * @param 		  	planes  	The outcode bits of the planes to clip against.
+ * @param [in,out]	polygons	The buffers.
+ * @param [out]		count   	The number of vertices of the clipped polygon.
+ * @return	The clipped polygon, which is in one of the buffers.
+ */
+
+static const VertexData *clipToViewVolume(const VertexData *triangle, int planes,
+											VertexData polygons[2][MAX_CLIPPED_VERTICES], int &count) {
+	const VertexData *input = triangle;
+	count = 3;
+	int next = 0;
+	for (int plane = 0; plane < NUM_CLIP_PLANES && count > 0; plane++) {
+		if ((planes & (1 << plane)) == 0) {
+			continue;
+		}
+		VertexData *output = polygons[next];
+		int n = 0;
+		for (int j = 0; j < count; j++) {
+			const VertexData &v0 = input[j];
+			const VertexData &v1 = input[j + 1 < count ? j + 1 : 0];
+			float d0 = clipDistance(v0.position, plane);
+			float d1 = clipDistance(v1.position, plane);
+			if (d0 >= 0) {
+				output[n++] = v0;
+			}
+			if ((d0 >= 0) != (d1 >= 0)) {
+				float t = d0 / (d0 - d1);
+				output[n++] = VertexData(1.0f - t, v0, t, v1);
 			}
 		}
+		input = output;
+		count = n;
+		next = 1 - next;
 	}
-	return output;
+	return input;
 }
 
 /**
- * @fn	std::vector<VertexData> VertexOps::clipPolygon(const std::vector<VertexData> &clipCoords)
- * @brief	Clip polygon against the normalized view volumn - 2x2x2 cube.
- * @param	clipCoords	The array of triangles.
- * @return	The array of triangles, after performing clipping.
+ * @fn	std::vector<VertexData> VertexOps::clipTriangles(const std::vector<VertexData> &clipCoords)
+ * @brief	Clips triangles against the view volume in clip coordinates, then performs
+ * 			the perspective division. From its vertices' outcodes, a triangle that is
+ * 			wholly inside is kept as is, and one wholly outside a plane is dropped.
+ * 			Only the others are clipped, against just the planes they cross, and
+ * 			the clipped polygons are split into triangles.
+ * @param	clipCoords	The triangle vertices, in clip coordinates.
+ * @return	The triangle vertices, in normalized device coordinates.
  */
 
-std::vector<VertexData> VertexOps::clipPolygon(const std::vector<VertexData> &clipCoords) {
+std::vector<VertexData> VertexOps::clipTriangles(const std::vector<VertexData> &clipCoords) {
 	std::vector<VertexData> ndcCoords;
-
-	if (clipCoords.size() > 2) {
-		for (unsigned int i = 0; i < clipCoords.size() - 2; i += 3) {
-			std::vector<VertexData> polygon;
-			polygon.push_back(clipCoords[i]);
-			polygon.push_back(clipCoords[i + 1]);
-			polygon.push_back(clipCoords[i + 2]);
-
-			for (IPlane plane : ndcPlanes) {
-				polygon = clipAgainstPlane(polygon, plane);
-			}
-			if (polygon.size() > 3) {
-				polygon = triangulate(polygon);
-			}
-			for (VertexData v : polygon) {
-				ndcCoords.push_back(v);
+	ndcCoords.reserve(clipCoords.size());
+	VertexData polygons[2][MAX_CLIPPED_VERTICES];
+
+	for (unsigned int i = 0; i + 2 < clipCoords.size(); i += 3) {
+		const VertexData *triangle = &clipCoords[i];
+		int code0 = outcode(triangle[0].position);
+		int code1 = outcode(triangle[1].position);
+		int code2 = outcode(triangle[2].position);
+		if ((code0 & code1 & code2) != 0) {		// wholly outside one of the planes
+			continue;
+		}
+		if ((code0 | code1 | code2) == 0) {		// wholly inside
+			for (int k = 0; k < 3; k++) {
+				addDividedVertex(ndcCoords, triangle[k]);
 			}
+			continue;
+		}
+		int count;
+		const VertexData *polygon = clipToViewVolume(triangle, code0 | code1 | code2, polygons, count);
+		for (int k = 1; k < count - 1; k++) {
+			addDividedVertex(ndcCoords, polygon[0]);
+			addDividedVertex(ndcCoords, polygon[k]);
+			addDividedVertex(ndcCoords, polygon[k + 1]);
 		}
 	}
 	return ndcCoords;
@@ -195,7 +253,8 @@ std::vector<VertexData> VertexOps::transformVerticesToWorldCoordinates(const glm
 
 /**
  * @fn	void VertexOps::applyLighting(const std::vector<LightSourcePtr> &lights, std::vector<VertexData> &worldCoords)
- * @brief	Applies the lighting to all the vertices. Modifies the VertexData's material field.
+ * @brief	Applies the lighting to all the vertices. Replaces each VertexData's material with
+ * 			a frame material whose ambient color is the vertex's light.
  * @param 		  	lights	   	The vector of lights in the scene.
  * @param [in,out]	worldCoords	The vector of world coordinates.
  */
@@ -204,14 +263,15 @@ void VertexOps::applyLighting(const std::vector<LightSourcePtr> &lights, std::ve
 	Frame eyeFrame = Frame::createOrthoNormalBasis(VertexOps::viewingTransformation);
 	for (unsigned int i = 0; i < worldCoords.size(); i++) {
 		VertexData &vert = worldCoords[i];
-		float alpha = worldCoords[i].material.alpha;
+		Material material = MaterialTable::get(vert.material);
 		color totalLight = black;
 
 		for (unsigned int j = 0; j < lights.size(); j++) {
-			totalLight += lights[j]->illuminate(vert.worldPosition, vert.normal, vert.material,
+			totalLight += lights[j]->illuminate(vert.worldPosition, vert.normal, material,
 												eyeFrame, false);
 		}
-		worldCoords[i].material.ambient = totalLight;
+		material.ambient = totalLight;
+		vert.material = MaterialTable::addFrameMaterial(material);
 	}
 }
 
@@ -236,6 +296,58 @@ std::vector<VertexData> VertexOps::transformVertices(const glm::mat4 &TM, const
 	return transformedVertices;
 }
 
+/**
+ * @fn	std::vector<VertexData> VertexOps::transformToClipCoordinates(const std::vector<VertexData> &objectCoords)
+ * @brief	Transforms vertices through the pipeline: object -> world -> eye -> clip.
+ * 			The world position is saved.
+ * @param	objectCoords	The vertices, in object coordinates.
+ * @return	The vertices, in clip coordinates.
+ */
+
+std::vector<VertexData> VertexOps::transformToClipCoordinates(const std::vector<VertexData> &objectCoords) {
+	std::vector<VertexData> worldCoords = transformVerticesToWorldCoordinates(modelingTransformation, objectCoords);
+	std::vector<VertexData> eyeCoords = transformVertices(viewingTransformation, worldCoords);
+	return transformVertices(projectionTransformation, eyeCoords);
+}
+
+/**
+ * @fn	std::vector<VertexData> VertexOps::transformToWindowCoordinates(const std::vector<VertexData> &clipCoords)
+ * @brief	Clips and culls triangles whose vertices have been through
+ * 			transformToClipCoordinates, and maps them onto the viewport.
+ * @param	clipCoords	The triangle vertices, in clip coordinates.
+ * @return	The vertices of the triangles to draw, in window coordinates.
+ */
+
+std::vector<VertexData> VertexOps::transformToWindowCoordinates(const std::vector<VertexData> &clipCoords) {
+	std::vector<VertexData> ndcCoords = clipTriangles(clipCoords);
+
+	if (!renderBackFaces)	// backface culling?
+		ndcCoords = removeBackwardFacingTriangles(ndcCoords);	
+
+	std::vector<VertexData> windowCoords = transformVertices(viewportTransformation, ndcCoords);
+
+	for (VertexData &vd : windowCoords) {
+		vd.position.x = glm::clamp(vd.position.x, (float)viewport.lx, (float)viewport.rx);
+		vd.position.y = glm::clamp(vd.position.y, (float)viewport.ly, (float)viewport.ry);
+	}
+	return windowCoords;
+}
+
+/**
+ * @fn	bool VertexOps::isUpToDate(const TransformedMesh &transformed, const IndexedMesh &mesh)
+ * @brief	Determines if a mesh's cached window coordinates can be drawn again: the
+ * 			mesh and all of the transformations are as they were when they were computed.
+ * @param	transformed	The cached window coordinates.
+ * @param	mesh	   	The mesh.
+ * @return	True iff the window coordinates are up to date.
+ */
+
+bool VertexOps::isUpToDate(const TransformedMesh &transformed, const IndexedMesh &mesh) {
+	return transformed.meshVersion == mesh.version && transformed.backFaces == renderBackFaces &&
+			transformed.modeling == modelingTransformation && transformed.viewing == viewingTransformation &&
+			transformed.projection == projectionTransformation && transformed.viewport == viewportTransformation;
+}
+
 /**
  * @fn	void VertexOps::processTriangleVertices(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights, const std::vector<VertexData> &objectCoords)
  * @brief	Transforms the triangle vertices through pipeline: object -> world -> eye -> clip/ndc -> window.
@@ -248,35 +360,87 @@ std::vector<VertexData> VertexOps::transformVertices(const glm::mat4 &TM, const
 void VertexOps::processTriangleVertices(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 										const std::vector<LightSourcePtr> &lights,
 										const std::vector<VertexData> &objectCoords) {
-	std::vector<VertexData> worldCoords = transformVerticesToWorldCoordinates(modelingTransformation, objectCoords);
-	std::vector<VertexData> eyeCoords = transformVertices(viewingTransformation, worldCoords);
-	glm::mat4 VM = VertexOps::viewingTransformation;
-	std::vector<VertexData> projCoords = transformVertices(projectionTransformation, eyeCoords);
-	std::vector<VertexData> clipCoords;
-	for (VertexData v : projCoords) {		// Perspective division
-		if (v.position.w >= 0)
-			v.position /= v.position.w;
-		else {
-			v.position.x /= -v.position.w;
-			v.position.y /= -v.position.w;
-			v.position.z = -std::abs(v.position.z);
-			v.position.w = 1.0f;
-		}
-		clipCoords.push_back(v);
+	if (renderControl != nullptr && renderControl->shouldStop()) {
+		return;
 	}
+	std::vector<VertexData> clipCoords = transformToClipCoordinates(objectCoords);
+	std::vector<VertexData> windowCoords = transformToWindowCoordinates(clipCoords);
+	drawManyFilledTriangles(frameBuffer, eyePos, lights, windowCoords, viewingTransformation, renderControl, rasterPool);
+}
 
-	if (!renderBackFaces)	// backface culling?
-		clipCoords = removeBackwardFacingTriangles(clipCoords);	
-
-	std::vector<VertexData> ndcCoords = clipPolygon(clipCoords);
-	std::vector<VertexData> windowCoords = transformVertices(viewportTransformation, ndcCoords);
+/**
+ * @fn	void VertexOps::processTriangleVertices(FrameBuffer &frameBuffer, const glm::vec3 &eyePos, const std::vector<LightSourcePtr> &lights, const IndexedMesh &mesh)
+ * @brief	Transforms each distinct vertex of a mesh through the pipeline once,
+ * 			then assembles the mesh's triangles from the results and draws them.
+ * 			With cacheTransformedMeshes, the triangles' window coordinates are kept,
+ * 			and drawn again without any vertex processing as long as the mesh and
+ * 			the transformations are unchanged.
+ * @param [in,out]	frameBuffer	Buffer for frame data.
+ * @param 		  	eyePos	   	The eye position.
+ * @param 		  	lights	   	The lights.
+ * @param 		  	mesh	   	The mesh, in object coordinates.
+ */
 
-	for (VertexData &vd : windowCoords) {
-		vd.position.x = glm::clamp(vd.position.x, (float)viewport.lx, (float)viewport.rx);
-		vd.position.y = glm::clamp(vd.position.y, (float)viewport.ly, (float)viewport.ry);
+void VertexOps::processTriangleVertices(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
+										const std::vector<LightSourcePtr> &lights,
+										const IndexedMesh &mesh) {
+	if (renderControl != nullptr && renderControl->shouldStop()) {
+		return;
 	}
+	TransformedMesh *cached = nullptr;
+	if (cacheTransformedMeshes) {
+		cached = &transformedMeshes[&mesh];
+		cached->lastFrame = frameNumber;
+		if (isUpToDate(*cached, mesh)) {
+			for (unsigned int i = 0; i < cached->clippedVertices.size(); i++) {
+				cached->windowCoords[cached->clippedVertices[i]].material =
+					MaterialTable::addFrameMaterial(cached->clippedMaterials[i]);
+			}
+			drawManyFilledTriangles(frameBuffer, eyePos, lights, cached->windowCoords,
+									viewingTransformation, renderControl, rasterPool);
+			return;
+		}
+	}
+	std::vector<VertexData> transformed = transformToClipCoordinates(mesh.vertices);
+	std::vector<VertexData> clipCoords;
+	clipCoords.reserve(mesh.indices.size());
+	for (unsigned int i = 0; i < mesh.indices.size(); i++) {
+		clipCoords.push_back(transformed[mesh.indices[i]]);
+	}
+	std::vector<VertexData> windowCoords = transformToWindowCoordinates(clipCoords);
+	drawManyFilledTriangles(frameBuffer, eyePos, lights, windowCoords, viewingTransformation, renderControl, rasterPool);
+	if (cached != nullptr) {
+		saveTransformedMesh(*cached, mesh, windowCoords);
+	}
+}
+
+/**
+ * @fn	void VertexOps::saveTransformedMesh(TransformedMesh &transformed, const IndexedMesh &mesh, std::vector<VertexData> &windowCoords)
+ * @brief	Caches a mesh's window coordinates, with the mesh version and the
+ * 			current transformations, and the frame materials clipping made.
+ * @param [in,out]	transformed 	The cache entry of the mesh.
+ * @param 		  	mesh			The mesh.
+ * @param [in,out]	windowCoords	The window coordinates. They are moved into the entry.
+ */
 
-	drawManyFilledTriangles(frameBuffer, eyePos, lights, windowCoords, viewingTransformation);
+void VertexOps::saveTransformedMesh(TransformedMesh &transformed, const IndexedMesh &mesh,
+									std::vector<VertexData> &windowCoords) {
+	transformed.meshVersion = mesh.version;
+	transformed.backFaces = renderBackFaces;
+	transformed.modeling = modelingTransformation;
+	transformed.viewing = viewingTransformation;
+	transformed.projection = projectionTransformation;
+	transformed.viewport = viewportTransformation;
+	transformed.windowCoords.swap(windowCoords);
+	transformed.clippedVertices.clear();
+	transformed.clippedMaterials.clear();
+	for (unsigned int i = 0; i < transformed.windowCoords.size(); i++) {
+		int material = transformed.windowCoords[i].material;
+		if (MaterialTable::isFrameMaterial(material)) {
+			transformed.clippedVertices.push_back(i);
+			transformed.clippedMaterials.push_back(MaterialTable::get(material));
+		}
+	}
 }
 
 /**
@@ -330,7 +494,7 @@ void VertexOps::processLineSegments(FrameBuffer &frameBuffer, const glm::vec3 &e
 }
 
 /**
- * @fn	void VertexOps::render(FrameBuffer &frameBuffer, const std::vector<VertexData> verts, const std::vector<LightSourcePtr> &lights, const glm::mat4 &TM)
+ * @fn	void VertexOps::render(FrameBuffer &frameBuffer, const std::vector<VertexData> &verts, const std::vector<LightSourcePtr> &lights, const glm::mat4 &TM)
  * @brief	Renders this object
  * @param [in,out]	frameBuffer	Buffer for frame data.
  * @param 		  	verts	   	The vertices.
@@ -338,7 +502,7 @@ void VertexOps::processLineSegments(FrameBuffer &frameBuffer, const glm::vec3 &e
  * @param 		  	TM		   	The time.
  */
 
-void VertexOps::render(FrameBuffer &frameBuffer, const std::vector<VertexData> verts,
+void VertexOps::render(FrameBuffer &frameBuffer, const std::vector<VertexData> &verts,
 							const std::vector<LightSourcePtr> &lights,
 							const glm::mat4 &TM) {
 	glm::vec3 eyePos = glm::inverse(VertexOps::viewingTransformation)[3].xyz;
@@ -346,6 +510,56 @@ void VertexOps::render(FrameBuffer &frameBuffer, const std::vector<VertexData> v
 	VertexOps::processTriangleVertices(frameBuffer, eyePos, lights, verts);
 }
 
+/**
+ * @fn	void VertexOps::render(FrameBuffer &frameBuffer, const IndexedMesh &mesh, const std::vector<LightSourcePtr> &lights, const glm::mat4 &TM)
+ * @brief	Renders an indexed mesh, transforming each of its distinct vertices once.
+ * @param [in,out]	frameBuffer	Buffer for frame data.
+ * @param 		  	mesh	   	The mesh.
+ * @param 		  	lights	   	The lights.
+ * @param 		  	TM		   	The modeling transformation.
+ */
+
+void VertexOps::render(FrameBuffer &frameBuffer, const IndexedMesh &mesh,
+						const std::vector<LightSourcePtr> &lights,
+						const glm::mat4 &TM) {
+	glm::vec3 eyePos = glm::inverse(VertexOps::viewingTransformation)[3].xyz;
+	VertexOps::modelingTransformation = TM;
+	VertexOps::processTriangleVertices(frameBuffer, eyePos, lights, mesh);
+}
+
+/**
+ * @fn	void VertexOps::shadeDeferred(FrameBuffer &frameBuffer, const std::vector<LightSourcePtr> &lights)
+ * @brief	Lights the pixels left in FragmentOps::gBuffer by the objects rendered
+ * 			since it was cleared, as seen with the current viewing transformation.
+ * @param [in,out]	frameBuffer	Buffer for frame data.
+ * @param 		  	lights	   	The lights.
+ */
+
+void VertexOps::shadeDeferred(FrameBuffer &frameBuffer, const std::vector<LightSourcePtr> &lights) {
+	glm::vec3 eyePos = glm::inverse(VertexOps::viewingTransformation)[3].xyz;
+	FragmentOps::shadeGBuffer(frameBuffer, eyePos, lights, viewingTransformation, rasterPool);
+}
+
+/**
+ * @fn	void VertexOps::beginFrame()
+ * @brief	Starts a new frame. The frame materials of the previous frame, made by
+ * 			clipping and lighting its vertices, are discarded, as are the cached
+ * 			window coordinates of meshes it did not draw, which may since have
+ * 			been destroyed.
+ */
+
+void VertexOps::beginFrame() {
+	MaterialTable::clearFrameMaterials();
+	for (auto it = transformedMeshes.begin(); it != transformedMeshes.end();) {
+		if (it->second.lastFrame != frameNumber) {
+			it = transformedMeshes.erase(it);
+		} else {
+			++it;
+		}
+	}
+	frameNumber++;
+}
+
 /**
  * @fn	void VertexOps::setViewport(float left, float right, float bottom, float top)
  * @brief	Sets a viewport to a particular setting.
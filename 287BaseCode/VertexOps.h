@@ -1,5 +1,6 @@
 #pragma once
 
+#include <unordered_map>
 #include "Defs.h"
 #include "FrameBuffer.h"
 #include "Light.h"
@@ -7,6 +8,28 @@
 #include "IScene.h"
 #include "Rasterization.h"
 
+/**
+ * @struct	TransformedMesh
+ * @brief	The window coordinates of a mesh's triangles, after culling and clipping,
+ * 			and the mesh version and transformations they were computed with. The
+ * 			materials clipping made only last a frame, so they are kept here too,
+ * 			and added to the MaterialTable again whenever the mesh is redrawn.
+ */
+
+struct TransformedMesh {
+	unsigned int meshVersion;			//!< version of the mesh
+	glm::mat4 modeling;					//!< the modeling transformation
+	glm::mat4 viewing;					//!< the viewing transformation
+	glm::mat4 projection;				//!< the projection transformation
+	glm::mat4 viewport;					//!< the viewport transformation
+	bool backFaces;						//!< true if backward facing triangles were kept
+	std::vector<VertexData> windowCoords;	//!< three per triangle, ready to rasterize
+	std::vector<int> clippedVertices;		//!< the window coordinates with frame materials
+	std::vector<Material> clippedMaterials;	//!< the frame material of each of those
+	unsigned int lastFrame;				//!< the last frame the mesh was drawn in
+	TransformedMesh() : meshVersion(0), backFaces(true), lastFrame(0) {}
+};
+
 /**
  * @class	VertexOps
  * @brief	Class to encapsulate the methods related to vertex processing.
@@ -19,6 +42,9 @@ public:
 	static glm::mat4 viewingTransformation;		//!< Orient/position camera.
 	static glm::mat4 projectionTransformation;	//!< Define projection. Typically set just once.
 	static glm::mat4 viewportTransformation;	//!< Controls where NDCs map onto window.
+	static const RenderControl *renderControl;	//!< If not null, lets the frame be abandoned part way.
+	static WorkerPool *rasterPool;				//!< If not null, triangles are drawn in screen tiles on these threads.
+	static bool cacheTransformedMeshes;			//!< True ==> reuse a mesh's window coordinates while it and the transformations are unchanged.
 
 	static const BoundingBox3D ndc;				//!< normalized device coordinate; the limits
 
@@ -27,6 +53,9 @@ public:
 	static void processTriangleVertices(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 										const std::vector<LightSourcePtr> &lights,
 										const std::vector<VertexData> &objectCoords);
+	static void processTriangleVertices(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
+										const std::vector<LightSourcePtr> &lights,
+										const IndexedMesh &mesh);
 	static void processTriangleVertices(FrameBuffer &frameBuffer,
 										const std::vector<LightSourcePtr> &lights,
 										const glm::mat4 &TM,
@@ -34,19 +63,30 @@ public:
 	static void processLineSegments(FrameBuffer &frameBuffer, const glm::vec3 &eyePos,
 									const std::vector<LightSourcePtr> &lights,
 									const std::vector<VertexData> &objectCoords);
-	static void VertexOps::render(FrameBuffer &frameBuffer, const std::vector<VertexData> verts,
+	static void VertexOps::render(FrameBuffer &frameBuffer, const std::vector<VertexData> &verts,
 								const std::vector<LightSourcePtr> &lights,
 								const glm::mat4 &TM);
+	static void render(FrameBuffer &frameBuffer, const IndexedMesh &mesh,
+						const std::vector<LightSourcePtr> &lights,
+						const glm::mat4 &TM);
+	static void shadeDeferred(FrameBuffer &frameBuffer, const std::vector<LightSourcePtr> &lights);
+	static void beginFrame();
 	static void setViewport(int left, int right, int bottom, int top);
 	static void setViewport(const BoundingBoxi &vp);
 protected:
 	static BoundingBoxi viewport;			//!< the currently active viewport
+	static std::unordered_map<const IndexedMesh *, TransformedMesh> transformedMeshes;	//!< the last window coordinates of each mesh drawn in the last frame
+	static unsigned int frameNumber;		//!< incremented by beginFrame
 	static void setViewportTransformation();
-	static std::vector<VertexData> clipAgainstPlane(std::vector<VertexData> &verts, const IPlane &plane);
-	static std::vector<VertexData> clipPolygon(const std::vector<VertexData> &clipCoords);
+	static std::vector<VertexData> clipTriangles(const std::vector<VertexData> &clipCoords);
 	static std::vector<VertexData> clipLineSegments(const std::vector<VertexData> &clipCoords);
 	static std::vector<VertexData> removeBackwardFacingTriangles(const std::vector<VertexData> &triangleVerts);
 	static std::vector<VertexData> transformVerticesToWorldCoordinates(const glm::mat4 &modelMatrix, const std::vector<VertexData> &vertices);
 	static void applyLighting(const std::vector<LightSourcePtr> &lights, std::vector<VertexData> &worldCoords);
 	static std::vector<VertexData> transformVertices(const glm::mat4 &TM, const std::vector<VertexData> &vertices);
+	static std::vector<VertexData> transformToClipCoordinates(const std::vector<VertexData> &objectCoords);
+	static std::vector<VertexData> transformToWindowCoordinates(const std::vector<VertexData> &clipCoords);
+	static bool isUpToDate(const TransformedMesh &transformed, const IndexedMesh &mesh);
+	static void saveTransformedMesh(TransformedMesh &transformed, const IndexedMesh &mesh,
+									std::vector<VertexData> &windowCoords);
 };
@@ -1,9 +1,10 @@
+#include <unordered_map>
 #include "VertexData.h"
 #include "Utilities.h"
 
 /**
- * @fn	VertexData::VertexData(const glm::vec4 &pos, const glm::vec3 &norm, const Material &mat, const glm::vec3 &worldPos) : position(pos), normal(glm::normalize(norm)), material(mat), worldPosition(worldPos)
- * @brief	Constructor
+ * @fn	VertexData::VertexData(const glm::vec4 &pos, const glm::vec3 &norm, const Material &mat, const glm::vec3 &worldPos) : position(pos), normal(glm::normalize(norm)), material(MaterialTable::indexOf(mat)), worldPosition(worldPos)
+ * @brief	Constructor. The material is added to the MaterialTable if it is new.
  * @param	pos			Current coordinate.
  * @param	norm		Normal vector
  * @param	mat			Material
@@ -14,12 +15,30 @@ VertexData::VertexData(const glm::vec4 &pos,
 				const glm::vec3 &norm,
 				const Material &mat,
 				const glm::vec3 &worldPos) :
-	position(pos), normal(glm::normalize(norm)), material(mat), worldPosition(worldPos) {
+	position(pos), normal(glm::normalize(norm)), material(MaterialTable::indexOf(mat)), worldPosition(worldPos) {
+}
+
+/**
+ * @fn	VertexData::VertexData(const glm::vec4 &pos, const glm::vec3 &norm, int materialIndex, const glm::vec3 &worldPos) : position(pos), normal(glm::normalize(norm)), material(materialIndex), worldPosition(worldPos)
+ * @brief	Constructor for a vertex whose material is already in the MaterialTable.
+ * @param	pos			 	Current coordinate.
+ * @param	norm		 	Normal vector
+ * @param	materialIndex	Index of the material in the MaterialTable.
+ * @param	worldPos	 	World position.
+ */
+
+VertexData::VertexData(const glm::vec4 &pos,
+				const glm::vec3 &norm,
+				int materialIndex,
+				const glm::vec3 &worldPos) :
+	position(pos), normal(glm::normalize(norm)), material(materialIndex), worldPosition(worldPos) {
 }
 
 /**
  * @fn	VertexData::VertexData(float w1, const VertexData &vd1, float w2, const VertexData &vd2)
- * @brief	Constructs object using weighted average of two VertexData objects.
+ * @brief	Constructs object using weighted average of two VertexData objects. The
+ * 			material is only averaged if the two materials differ, and the average is
+ * 			added to the MaterialTable as a frame material.
  * @param	w1 	Weight #1.
  * @param	vd1	VertexData #1.
  * @param	w2 	Weight #2.
@@ -30,8 +49,12 @@ VertexData::VertexData(float w1, const VertexData &vd1,
 					float w2, const VertexData &vd2)
 					: position(weightedAverage(w1, vd1.position, w2, vd2.position)),
 						normal(weightedAverage(w1, vd1.normal, w2, vd2.normal)),
-						material(weightedAverage(w1, vd1.material, w2, vd2.material)),
+						material(vd1.material),
 						worldPosition(weightedAverage(w1, vd1.worldPosition, w2, vd2.worldPosition)) {
+	if (vd1.material != vd2.material) {
+		material = MaterialTable::addFrameMaterial(weightedAverage(w1, MaterialTable::get(vd1.material),
+																w2, MaterialTable::get(vd2.material)));
+	}
 }
 
 /**
@@ -142,14 +165,14 @@ void VertexData::addConvexPolyVertsAndComputeNormals(std::vector<VertexData> &ve
 
 /**
  * @fn	VertexData operator* (float w, const VertexData &data)
- * @brief	Multiplication operator for VertexData objects
+ * @brief	Multiplication operator for VertexData objects. The material is not scaled.
  * @param	w   	The scalar multiplier.
  * @param	data	Vertex data to scale.
  * @return	The scaled Vertex data.
  */
 
 VertexData operator * (float w, const VertexData &data) {
-	VertexData result(w*data.position, w*data.normal, w*data.material, w*data.worldPosition);
+	VertexData result(w*data.position, w*data.normal, data.material, w*data.worldPosition);
 	return result;
 }
 
@@ -157,14 +180,82 @@ VertexData operator * (float w, const VertexData &data) {
  * @fn	VertexData VertexData::operator+ (const VertexData &other) const
  * @brief	Addition operator for VertexData objects
  * @param	other	The 2nd VertexData object.
- * @return	The raw summation of the two VertexData objects
+ * @return	The raw summation of the two VertexData objects, with this object's material.
  */
 
 VertexData VertexData::operator + (const VertexData &other) const {
 	VertexData result(*this);
-	result.material += other.material;
 	result.normal += other.normal;
 	result.position += other.position;
 	result.worldPosition += other.worldPosition;
 	return result;
 }
+
+/**
+ * @fn	bool VertexData::operator== (const VertexData &other) const
+ * @brief	Compares two VertexData objects
+ * @param	other	The 2nd VertexData object.
+ * @return	True iff all the attributes of the two vertices are equal.
+ */
+
+bool VertexData::operator == (const VertexData &other) const {
+	return position == other.position && normal == other.normal &&
+			worldPosition == other.worldPosition && material == other.material;
+}
+
+/**
+ * @struct	VertexHash
+ * @brief	Hashes a VertexData from its attributes, for finding duplicate vertices.
+ */
+
+struct VertexHash {
+	size_t operator ()(const VertexData &v) const {
+		const float attributes[] = { v.position.x, v.position.y, v.position.z, v.position.w,
+									v.normal.x, v.normal.y, v.normal.z,
+									v.worldPosition.x, v.worldPosition.y, v.worldPosition.z };
+		size_t h = std::hash<int>()(v.material);
+		for (float a : attributes) {
+			h = h * 31 + std::hash<float>()(a);
+		}
+		return h;
+	}
+};
+
+unsigned int IndexedMesh::lastVersion = 0;
+
+/**
+ * @fn	IndexedMesh::IndexedMesh()
+ * @brief	Constructs an empty mesh.
+ */
+
+IndexedMesh::IndexedMesh() : version(++lastVersion) {
+}
+
+/**
+ * @fn	IndexedMesh::IndexedMesh(const std::vector<VertexData> &triangleVerts)
+ * @brief	Constructs a mesh from triangle vertices, where each successive triplet
+ * 			is a triangle. Vertices whose attributes are all equal are merged.
+ * @param	triangleVerts	The triangle vertices.
+ */
+
+IndexedMesh::IndexedMesh(const std::vector<VertexData> &triangleVerts) : version(++lastVersion) {
+	std::unordered_map<VertexData, unsigned int, VertexHash> seen;
+	unsigned int numVerts = (unsigned int)triangleVerts.size() / 3 * 3;
+	indices.reserve(numVerts);
+	for (unsigned int i = 0; i < numVerts; i++) {
+		auto it = seen.insert(std::make_pair(triangleVerts[i], (unsigned int)vertices.size())).first;
+		if (it->second == vertices.size()) {
+			vertices.push_back(triangleVerts[i]);
+		}
+		indices.push_back(it->second);
+	}
+}
+
+/**
+ * @fn	void IndexedMesh::changed()
+ * @brief	Gives the mesh a new version, after its vertices or indices were modified.
+ */
+
+void IndexedMesh::changed() {
+	version = ++lastVersion;
+}
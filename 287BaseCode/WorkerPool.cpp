@@ -0,0 +1,120 @@
+#include <algorithm>
+#include "WorkerPool.h"
+
+/**
+ * @fn	WorkerPool::WorkerPool()
+ * @brief	Constructs a pool with a helper thread for every hardware thread but
+ * 			the caller's.
+ */
+
+WorkerPool::WorkerPool()
+	: batchJob(nullptr), batchSize(0), nextJob(0), batchNumber(0), activeWorkers(0), shuttingDown(false) {
+	start(std::max((int)std::thread::hardware_concurrency() - 1, 0));
+}
+
+/**
+ * @fn	WorkerPool::WorkerPool(int numHelpers)
+ * @brief	Constructs a pool with a given number of helper threads.
+ * @param	numHelpers	Number of threads besides the caller's; zero runs every job on the caller.
+ */
+
+WorkerPool::WorkerPool(int numHelpers)
+	: batchJob(nullptr), batchSize(0), nextJob(0), batchNumber(0), activeWorkers(0), shuttingDown(false) {
+	start(std::max(numHelpers, 0));
+}
+
+/**
+ * @fn	WorkerPool::~WorkerPool()
+ * @brief	Stops the helper threads.
+ */
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		shuttingDown = true;
+	}
+	workReady.notify_all();
+	for (unsigned int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+/**
+ * @fn	void WorkerPool::start(int numHelpers)
+ * @brief	Starts the helper threads.
+ * @param	numHelpers	Number of helper threads.
+ */
+
+void WorkerPool::start(int numHelpers) {
+	for (int i = 0; i < numHelpers; i++) {
+		workers.push_back(std::thread(&WorkerPool::workerLoop, this));
+	}
+}
+
+/**
+ * @fn	void WorkerPool::run(int numJobs, const std::function<void(int)> &job)
+ * @brief	Runs job(0) .. job(numJobs - 1), in no particular order and on any of
+ * 			the threads, and returns when all of them have finished. Must not be
+ * 			called from more than one thread at a time.
+ * @param	numJobs	Number of jobs.
+ * @param	job	   	The job, given its number.
+ */
+
+void WorkerPool::run(int numJobs, const std::function<void(int)> &job) {
+	if (workers.empty() || numJobs <= 1) {
+		for (int i = 0; i < numJobs; i++) {
+			job(i);
+		}
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		batchJob = &job;
+		batchSize = numJobs;
+		nextJob = 0;
+		activeWorkers = (int)workers.size();
+		batchNumber++;
+	}
+	workReady.notify_all();
+	doJobs();
+	std::unique_lock<std::mutex> guard(lock);
+	workDone.wait(guard, [this] { return activeWorkers == 0; });
+	batchJob = nullptr;
+}
+
+/**
+ * @fn	void WorkerPool::workerLoop()
+ * @brief	Body of each helper thread. Waits for a batch, then takes jobs until
+ * 			none are left.
+ */
+
+void WorkerPool::workerLoop() {
+	unsigned int lastBatch = 0;
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		workReady.wait(guard, [&] { return shuttingDown || batchNumber != lastBatch; });
+		if (shuttingDown) {
+			return;
+		}
+		lastBatch = batchNumber;
+		guard.unlock();
+		doJobs();
+		guard.lock();
+		activeWorkers--;
+		if (activeWorkers == 0) {
+			workDone.notify_all();
+		}
+	}
+}
+
+/**
+ * @fn	void WorkerPool::doJobs()
+ * @brief	Takes jobs from the current batch until none are left.
+ */
+
+void WorkerPool::doJobs() {
+	int i;
+	while ((i = nextJob.fetch_add(1)) < batchSize) {
+		(*batchJob)(i);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+/**
+ * @struct	WorkerPool
+ * @brief	A set of threads that run numbered jobs in parallel. The threads are
+ * 			started once and wait between batches, so a batch costs a wake-up
+ * 			rather than a thread launch. The thread that calls run takes jobs too.
+ */
+
+struct WorkerPool {
+	WorkerPool();
+	WorkerPool(int numHelpers);
+	~WorkerPool();
+	void run(int numJobs, const std::function<void(int)> &job);
+	int numThreads() const { return (int)workers.size() + 1; }
+protected:
+	std::vector<std::thread> workers;			//!< the helper threads
+	std::mutex lock;							//!< guards the fields below
+	std::condition_variable workReady;			//!< signaled when a batch starts
+	std::condition_variable workDone;			//!< signaled when the last helper finishes a batch
+	const std::function<void(int)> *batchJob;	//!< the job of the current batch
+	int batchSize;								//!< number of jobs in the current batch
+	std::atomic<int> nextJob;					//!< next job to hand out
+	unsigned int batchNumber;					//!< incremented for each batch
+	int activeWorkers;							//!< helpers still working on the batch
+	bool shuttingDown;							//!< true when the helpers should exit
+	void start(int numHelpers);
+	void workerLoop();
+	void doJobs();
+};